@@ -0,0 +1,242 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#include "util/ApCache.h"
+#include "util/FblPool.h"
+#include "util/FblThread.h"
+
+using namespace FBL;
+
+// Headless batch labeling: <wav dir> + <TextGrid dir> -> <out dir>, with a JSON summary of the run.
+// Exit code is 0 if every file succeeded, 1 if some failed and 2 if the run could not start.
+
+struct FileResult {
+    QString filename;
+    bool success = false;
+    QString msg;
+    qint64 elapsedMs = 0;
+};
+
+static QString defaultModelFolder() {
+    return QDir::cleanPath(
+#ifdef Q_OS_MAC
+        QCoreApplication::applicationDirPath() + "/../Resources/fbl_model"
+#else
+        QCoreApplication::applicationDirPath() + QDir::separator() + "fbl_model"
+#endif
+    );
+}
+
+static qint64 percentile(const QList<qint64> &sorted, const double p) {
+    if (sorted.isEmpty())
+        return 0;
+    const auto index = static_cast<int>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::clamp(index, 0, static_cast<int>(sorted.size()) - 1)];
+}
+
+static QJsonObject makeSummary(const QList<FileResult> &results, const qint64 wallMs, const int workers,
+                               const float apThreshold, const float apDur, const float spDur) {
+    QJsonArray files;
+    QList<qint64> latencies;
+    int failed = 0;
+    for (const auto &result : results) {
+        QJsonObject file;
+        file["file"] = result.filename;
+        file["success"] = result.success;
+        file["latencyMs"] = result.elapsedMs;
+        if (!result.msg.isEmpty())
+            file["message"] = result.msg;
+        files.append(file);
+
+        latencies.append(result.elapsedMs);
+        if (!result.success)
+            failed++;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    qint64 latencySum = 0;
+    for (const auto &latency : latencies)
+        latencySum += latency;
+
+    QJsonObject latency;
+    latency["mean"] = latencies.isEmpty() ? 0.0 : static_cast<double>(latencySum) / latencies.size();
+    latency["p50"] = percentile(latencies, 0.5);
+    latency["p95"] = percentile(latencies, 0.95);
+    latency["max"] = latencies.isEmpty() ? 0 : latencies.last();
+
+    QJsonObject params;
+    params["ap_threshold"] = apThreshold;
+    params["ap_dur"] = apDur;
+    params["sp_dur"] = spDur;
+
+    QJsonObject summary;
+    summary["total"] = results.size();
+    summary["success"] = results.size() - failed;
+    summary["failed"] = failed;
+    summary["workers"] = workers;
+    summary["wallMs"] = wallMs;
+    summary["filesPerSecond"] = wallMs > 0 ? results.size() * 1000.0 / wallMs : 0.0;
+    summary["latencyMs"] = latency;
+    summary["params"] = params;
+    summary["files"] = files;
+    return summary;
+}
+
+static bool readFloatOption(const QCommandLineParser &parser, const QCommandLineOption &option, float &value) {
+    bool ok = false;
+    value = parser.value(option).toFloat(&ok);
+    if (!ok)
+        fprintf(stderr, "Invalid value for --%s: %s\n", qPrintable(option.names().constFirst()),
+                qPrintable(parser.value(option)));
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("FoxBreatheLabelerCli");
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Adds AP/SP intervals to SOFA TextGrids without the GUI.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("wav-dir", "Folder of .wav files.");
+    parser.addPositionalArgument("tg-dir", "Folder of raw TextGrids with the same base names.");
+    parser.addPositionalArgument("out-dir", "Output folder, created if missing.");
+
+    const QCommandLineOption apThresholdOption("ap-threshold", "AP probability threshold (default 0.4).", "value",
+                                               "0.4");
+    const QCommandLineOption apDurOption("ap-dur", "Shortest AP segment in seconds (default 0.08).", "seconds",
+                                         "0.08");
+    const QCommandLineOption spDurOption("sp-dur", "Shortest SP gap in seconds (default 0.1).", "seconds", "0.1");
+    const QCommandLineOption modelOption("model", "Model folder with model.onnx and config.yaml.", "dir",
+                                         defaultModelFolder());
+    const QCommandLineOption workersOption(
+        "workers", "Number of parallel sessions (default min(4, cores), 1 on GPU).", "count");
+    const QCommandLineOption gpuOption("gpu", "Run on the GPU with this device index.", "index");
+    const QCommandLineOption cacheOption(
+        "cache", "Reuse and store raw model output in this folder, so sweeps skip inference.", "dir");
+    const QCommandLineOption summaryOption("summary", "Write the JSON summary to this file instead of stdout.",
+                                           "file");
+    parser.addOptions({apThresholdOption, apDurOption, spDurOption, modelOption, workersOption, gpuOption,
+                       cacheOption, summaryOption});
+    parser.process(a);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 3) {
+        fprintf(stderr, "%s\n", qPrintable(parser.helpText()));
+        return 2;
+    }
+    const QString wavDir = args[0];
+    const QString rawTgDir = args[1];
+    const QString outTgDir = args[2];
+
+    float apThreshold, apDur, spDur;
+    if (!readFloatOption(parser, apThresholdOption, apThreshold) || !readFloatOption(parser, apDurOption, apDur) ||
+        !readFloatOption(parser, spDurOption, spDur))
+        return 2;
+
+    const bool useGpu = parser.isSet(gpuOption);
+    const int deviceIndex = useGpu ? parser.value(gpuOption).toInt() : 0;
+    int workers = useGpu ? 1 : std::min(4, QThread::idealThreadCount());
+    if (parser.isSet(workersOption))
+        workers = std::clamp(parser.value(workersOption).toInt(), 1, QThread::idealThreadCount());
+
+    if (!QDir(wavDir).exists() || !QDir(rawTgDir).exists()) {
+        fprintf(stderr, "Wav or TextGrid folder does not exist.\n");
+        return 2;
+    }
+    if (!QDir().mkpath(outTgDir)) {
+        fprintf(stderr, "Cannot create output folder: %s\n", qPrintable(outTgDir));
+        return 2;
+    }
+
+    QList<FblTask> tasks;
+    const QDir dir(wavDir);
+    for (const auto &wavFile : dir.entryList({"*.wav"}, QDir::Files, QDir::Name)) {
+        const QString baseName = QFileInfo(wavFile).completeBaseName();
+        tasks.append({wavFile, dir.absoluteFilePath(wavFile),
+                      rawTgDir + QDir::separator() + baseName + ".TextGrid",
+                      outTgDir + QDir::separator() + baseName + ".TextGrid"});
+    }
+
+    FblPool pool(parser.value(modelOption), useGpu, deviceIndex);
+    QString poolMsg;
+    if (!pool.init(workers, poolMsg)) {
+        fprintf(stderr, "Could not load model: %s\n", qPrintable(poolMsg));
+        return 2;
+    }
+
+    std::unique_ptr<ApCache> cache;
+    if (parser.isSet(cacheOption)) {
+        cache = std::make_unique<ApCache>(parser.value(cacheOption), parser.value(modelOption));
+        if (!cache->isValid()) {
+            fprintf(stderr, "Cannot use cache folder: %s\n", qPrintable(parser.value(cacheOption)));
+            return 2;
+        }
+    }
+
+    QThreadPool threadPool;
+    threadPool.setMaxThreadCount(workers);
+
+    // Results arrive queued on the main thread, so the list needs no locking.
+    QList<FileResult> results;
+    const auto addResult = [&](const QString &filename, const QString &msg, const qint64 elapsedMs,
+                               const bool success) {
+        results.append({filename, success, msg, elapsedMs});
+        fprintf(stderr, "[%d/%d] %s%s%s\n", static_cast<int>(results.size()), static_cast<int>(tasks.size()),
+                qPrintable(filename), msg.isEmpty() ? "" : ": ", qPrintable(msg));
+        if (results.size() == tasks.size())
+            QCoreApplication::quit();
+    };
+
+    QElapsedTimer wallTimer;
+    wallTimer.start();
+    for (const auto &batch : FblThread::makeBatches(tasks)) {
+        const auto fblThread = new FblThread(&pool, batch, apThreshold, apDur, spDur, cache.get());
+        QObject::connect(fblThread, &FblThread::oneFailed, &a,
+                         [&](const QString &filename, const QString &msg, const qint64 elapsedMs) {
+                             addResult(filename, msg, elapsedMs, false);
+                         });
+        QObject::connect(fblThread, &FblThread::oneFinished, &a,
+                         [&](const QString &filename, const QString &msg, const qint64 elapsedMs) {
+                             addResult(filename, msg, elapsedMs, true);
+                         });
+        threadPool.start(fblThread);
+    }
+
+    if (!tasks.isEmpty())
+        QCoreApplication::exec();
+    threadPool.waitForDone();
+    const qint64 wallMs = wallTimer.elapsed();
+
+    std::sort(results.begin(), results.end(),
+              [](const FileResult &lhs, const FileResult &rhs) { return lhs.filename < rhs.filename; });
+    const QJsonObject summary = makeSummary(results, wallMs, workers, apThreshold, apDur, spDur);
+    const QByteArray json = QJsonDocument(summary).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(summaryOption)) {
+        QFile file(parser.value(summaryOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            fprintf(stderr, "Cannot write summary: %s\n", qPrintable(file.errorString()));
+            return 2;
+        }
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    return summary["failed"].toInt() == 0 ? 0 : 1;
+}
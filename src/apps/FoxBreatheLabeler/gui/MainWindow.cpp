@@ -11,6 +11,9 @@
 
 #include "QMSystem.h"
 #include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
 
 #include "DeviceDialog.h"
 #include "../util/FblThread.h"
@@ -37,6 +40,7 @@ namespace FBL {
             }
             else {
                 QString fblErrorMessage;
+                int deviceIndex = 0;
 #ifdef ONNXRUNTIME_ENABLE_DML
                 auto gpuList = getDirectXGPUs();
                 DeviceDialog deviceDialog(gpuList);
@@ -44,19 +48,20 @@ namespace FBL {
                     if (deviceDialog.useGpu()) {
                         useGpu = true;
                     }
-                    int deviceIndex = deviceDialog.deviceIndex();
-                    m_fbl = new FBL(modelFolder, useGpu, deviceIndex, &isFblLoaded, &fblErrorMessage);
-                } else {
-                    m_fbl = new FBL(modelFolder, false, 0, &isFblLoaded, &fblErrorMessage);
+                    deviceIndex = deviceDialog.deviceIndex();
                 }
-#else
-                m_fbl = new FBL(modelFolder, false, 0, &isFblLoaded, &fblErrorMessage);
 #endif
+                m_fblPool = new FblPool(modelFolder, useGpu, deviceIndex);
+                isFblLoaded = m_fblPool->init(1, fblErrorMessage);
                 if (!isFblLoaded) {
                     QMessageBox::warning(this, "Could not load model",
                                          fblErrorMessage);
-                    delete m_fbl;
-                    m_fbl = nullptr;
+                    delete m_fblPool;
+                    m_fblPool = nullptr;
+                } else {
+                    m_apCache = new ApCache(
+                        QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/ap_probability",
+                        modelFolder);
                 }
             }
         } else {
@@ -106,6 +111,7 @@ namespace FBL {
         apThreshLayout = new QHBoxLayout();
         apDurLayout = new QHBoxLayout();
         spDurLayout = new QHBoxLayout();
+        workersLayout = new QHBoxLayout();
 
         rawTgEdit = new QLineEdit(R"(D:\python\FoxBreatheLabeler\raw_textgrid)");
         const auto btnRawTg = new QPushButton("Open Folder");
@@ -141,6 +147,19 @@ namespace FBL {
         spDurLayout->addWidget(spDurLabel);
         spDurLayout->addWidget(sp_dur);
 
+        // Every worker owns a full ORT session; on GPU they would just queue on the same device.
+        const auto workersLabel = new QLabel("Workers");
+        workers = new QSpinBox();
+        workers->setRange(1, QThread::idealThreadCount());
+        workers->setValue(useGpu ? 1 : std::min(4, QThread::idealThreadCount()));
+        workersLayout->addWidget(workersLabel);
+        workersLayout->addWidget(workers);
+
+        // Parameter sweeps then only redo segmentation and the TextGrid merge.
+        cacheBox = new QCheckBox("Reuse cached model output");
+        cacheBox->setChecked(true);
+        cacheBox->setEnabled(m_apCache && m_apCache->isValid());
+
         const auto rawTgLabel = new QLabel("Raw TextGrid Path:");
         const auto outTgLabel = new QLabel("Out TextGrid Path:");
 
@@ -151,6 +170,8 @@ namespace FBL {
         rightLayout->addLayout(apThreshLayout);
         rightLayout->addLayout(apDurLayout);
         rightLayout->addLayout(spDurLayout);
+        rightLayout->addLayout(workersLayout);
+        rightLayout->addWidget(cacheBox);
         rightLayout->addStretch(1);
 
         listLayout->addWidget(taskList, 3);
@@ -202,7 +223,11 @@ namespace FBL {
         resize(960, 720);
     }
 
-    MainWindow::~MainWindow() = default;
+    MainWindow::~MainWindow() {
+        m_threadpool->waitForDone();
+        delete m_fblPool;
+        delete m_apCache;
+    }
 
     void MainWindow::addFiles(const QStringList &paths) const {
         for (const auto &path : paths) {
@@ -319,8 +344,14 @@ namespace FBL {
     }
 
     void MainWindow::slot_runFbl() {
-        out->clear();
-        m_threadpool->clear();
+        if (!m_fblPool) {
+            QMessageBox::information(nullptr, "Warning",
+                                     "FoxBreatheLabeler model is not loaded. Please read ReadMe.md and check the model.");
+            return;
+        }
+
+        if (taskList->count() == 0)
+            return;
 
         const auto rawTgDir = rawTgEdit->text();
         if (!QDir(rawTgDir).exists()) {
@@ -336,6 +367,18 @@ namespace FBL {
             return;
         }
 
+        QString poolMsg;
+        const int workerCount = workers->value();
+        if (!m_fblPool->init(workerCount, poolMsg)) {
+            QMessageBox::warning(this, "Could not load model", poolMsg);
+            return;
+        }
+        m_threadpool->setMaxThreadCount(workerCount);
+
+        // init() may recreate sessions that batches hold, so Run stays disabled until the last task has reported.
+        runFbl->setEnabled(false);
+        out->clear();
+
         m_workError = 0;
         m_workFinished = 0;
         m_workTotal = taskList->count();
@@ -346,15 +389,19 @@ namespace FBL {
         const auto ap_duration = ap_dur->value();
         const auto sp_duration = sp_dur->value();
 
+        QList<FblTask> tasks;
         for (int i = 0; i < taskList->count(); i++) {
             const auto item = taskList->item(i);
             const QString rawTgPath =
                 rawTgDir + QDir::separator() + QFileInfo(item->text()).completeBaseName() + ".TextGrid";
             const QString outTgPath =
                 outTgDir + QDir::separator() + QFileInfo(item->text()).completeBaseName() + ".TextGrid";
+            tasks.append({item->text(), item->data(Qt::UserRole + 1).toString(), rawTgPath, outTgPath});
+        }
 
-            const auto asrTread = new FblThread(m_fbl, item->text(), item->data(Qt::UserRole + 1).toString(), rawTgPath,
-                                                outTgPath, ap_thresh, ap_duration, sp_duration);
+        const ApCache *cache = cacheBox->isEnabled() && cacheBox->isChecked() ? m_apCache : nullptr;
+        for (const auto &batch : FblThread::makeBatches(tasks)) {
+            const auto asrTread = new FblThread(m_fblPool, batch, ap_thresh, ap_duration, sp_duration, cache);
             connect(asrTread, &FblThread::oneFailed, this, &MainWindow::slot_oneFailed);
             connect(asrTread, &FblThread::oneFinished, this, &MainWindow::slot_oneFinished);
             m_threadpool->start(asrTread);
@@ -421,5 +468,6 @@ namespace FBL {
         m_workFinished = 0;
         m_workError = 0;
         m_workTotal = 0;
+        runFbl->setEnabled(true);
     }
 }
\ No newline at end of file
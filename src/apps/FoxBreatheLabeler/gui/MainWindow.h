@@ -14,9 +14,11 @@
 #include <QPushButton>
 #include <QThreadPool>
 
-#include "../util/Fbl.h"
+#include "../util/ApCache.h"
+#include "../util/FblPool.h"
 
 #include <QDoubleSpinBox>
+#include <QSpinBox>
 
 namespace FBL {
     class MainWindow final : public QMainWindow {
@@ -54,6 +56,7 @@ namespace FBL {
         QHBoxLayout *apThreshLayout;
         QHBoxLayout *apDurLayout;
         QHBoxLayout *spDurLayout;
+        QHBoxLayout *workersLayout;
 
         QLineEdit *rawTgEdit;
         QLineEdit *outTgEdit;
@@ -61,6 +64,8 @@ namespace FBL {
         QDoubleSpinBox *ap_threshold;
         QDoubleSpinBox *ap_dur;
         QDoubleSpinBox *sp_dur;
+        QSpinBox *workers;
+        QCheckBox *cacheBox;
 
         QCheckBox *pinyinBox;
 
@@ -75,7 +80,8 @@ namespace FBL {
         void closeEvent(QCloseEvent *event) override;
 
     private:
-        FBL *m_fbl = nullptr;
+        FblPool *m_fblPool = nullptr;
+        ApCache *m_apCache = nullptr;
 
         int m_workTotal = 0;
         int m_workFinished = 0;
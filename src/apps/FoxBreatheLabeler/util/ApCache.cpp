@@ -0,0 +1,163 @@
+#include "ApCache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace FBL {
+    // File layout, little endian: magic, quint32 frames, float time scale, quint16 samples[frames].
+    static constexpr char Magic[8] = {'F', 'B', 'L', 'A', 'P', 'C', '0', '1'};
+    static constexpr qsizetype HeaderSize = sizeof(Magic) + sizeof(quint32) + sizeof(float);
+    static constexpr float QuantScale = 65535.0f;
+
+    static quint16 quantize(const float value) {
+        return static_cast<quint16>(std::lround(std::clamp(value, 0.0f, 1.0f) * QuantScale));
+    }
+
+    static float dequantize(const quint16 value) {
+        return static_cast<float>(value) / QuantScale;
+    }
+
+    static bool hashFile(const QString &path, QCryptographicHash &hash) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        return hash.addData(&file);
+    }
+
+    static QFileInfoList cacheFiles(const QString &cacheDir) {
+        // Oldest first
+        return QDir(cacheDir).entryInfoList({"*.apc"}, QDir::Files, QDir::Time | QDir::Reversed);
+    }
+
+    ApCache::ApCache(QString cacheDir, const QString &modelDir, const qint64 maxBytes)
+        : m_cacheDir(std::move(cacheDir)), m_maxBytes(maxBytes) {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (!hashFile(modelDir + QDir::separator() + "model.onnx", hash) ||
+            !hashFile(modelDir + QDir::separator() + "config.yaml", hash))
+            return;
+        if (!QDir().mkpath(m_cacheDir))
+            return;
+        m_modelHash = hash.result();
+
+        qint64 bytes = 0;
+        for (const auto &info : cacheFiles(m_cacheDir))
+            bytes += info.size();
+        m_bytes = bytes;
+        if (bytes > m_maxBytes)
+            prune();
+    }
+
+    bool ApCache::isValid() const {
+        return !m_modelHash.isEmpty();
+    }
+
+    QString ApCache::cacheDir() const {
+        return m_cacheDir;
+    }
+
+    QByteArray ApCache::key(const QString &wavPath) const {
+        if (!isValid())
+            return {};
+
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (!hashFile(wavPath, hash))
+            return {};
+        hash.addData(m_modelHash);
+        return hash.result().toHex();
+    }
+
+    QString ApCache::filePath(const QByteArray &key) const {
+        return m_cacheDir + QDir::separator() + QString::fromLatin1(key) + ".apc";
+    }
+
+    bool ApCache::load(const QByteArray &key, std::vector<float> &prob, float &timeScale) const {
+        if (key.isEmpty())
+            return false;
+
+        QFile file(filePath(key));
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        const QByteArray data = file.readAll();
+        if (data.size() < HeaderSize || std::memcmp(data.constData(), Magic, sizeof(Magic)) != 0)
+            return false;
+
+        const char *cursor = data.constData() + sizeof(Magic);
+        const quint32 frames = qFromLittleEndian<quint32>(cursor);
+        cursor += sizeof(quint32);
+        const quint32 scaleBits = qFromLittleEndian<quint32>(cursor);
+        cursor += sizeof(quint32);
+        if (data.size() != HeaderSize + static_cast<qsizetype>(frames) * 2)
+            return false;
+
+        std::memcpy(&timeScale, &scaleBits, sizeof(float));
+        if (!(timeScale > 0))
+            return false;
+        prob.resize(frames);
+        for (quint32 i = 0; i < frames; ++i)
+            prob[i] = dequantize(qFromLittleEndian<quint16>(cursor + i * 2));
+
+        // Pruning goes by modification time, so a hit keeps the curve. Where it cannot be set, the oldest store
+        // goes first.
+        file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        return true;
+    }
+
+    bool ApCache::store(const QByteArray &key, std::vector<float> &prob, const float timeScale, QString &msg) const {
+        QByteArray data(HeaderSize + static_cast<qsizetype>(prob.size()) * 2, Qt::Uninitialized);
+        char *cursor = data.data();
+        std::memcpy(cursor, Magic, sizeof(Magic));
+        cursor += sizeof(Magic);
+        qToLittleEndian<quint32>(static_cast<quint32>(prob.size()), cursor);
+        cursor += sizeof(quint32);
+        quint32 scaleBits;
+        std::memcpy(&scaleBits, &timeScale, sizeof(float));
+        qToLittleEndian<quint32>(scaleBits, cursor);
+        cursor += sizeof(quint32);
+
+        for (size_t i = 0; i < prob.size(); ++i) {
+            const quint16 value = quantize(prob[i]);
+            qToLittleEndian<quint16>(value, cursor + i * 2);
+            prob[i] = dequantize(value);
+        }
+
+        if (key.isEmpty())
+            return false;
+
+        // Written under a temporary name, so a concurrent reader never sees half a file.
+        QSaveFile file(filePath(key));
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+            msg = "Cannot write AP cache: " + file.errorString();
+            return false;
+        }
+        if ((m_bytes += data.size()) > m_maxBytes)
+            prune();
+        return true;
+    }
+
+    void ApCache::prune() const {
+        // One thread prunes, the others keep storing meanwhile.
+        if (!m_pruneMutex.tryLock())
+            return;
+
+        const auto files = cacheFiles(m_cacheDir);
+        qint64 bytes = 0;
+        for (const auto &info : files)
+            bytes += info.size();
+        for (const auto &info : files) {
+            if (bytes <= m_maxBytes / 4 * 3)
+                break;
+            if (QFile::remove(info.absoluteFilePath()))
+                bytes -= info.size();
+        }
+        m_bytes = bytes;
+        m_pruneMutex.unlock();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef APCACHE_H
+#define APCACHE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+#include <vector>
+
+namespace FBL {
+    // Raw ap_probability curves on disk, keyed by the hash of the audio file and of the model, so changing
+    // ap_threshold, ap_dur or sp_dur only reruns segmentation and the TextGrid merge. Curves are stored as
+    // 16-bit fixed point (2 bytes per frame). Lookups and stores are file-local, one cache can be shared by
+    // all worker threads. A load marks the file as used; once a store takes the directory past maxBytes, the least
+    // recently used curves are deleted down to three quarters of it.
+    class ApCache {
+    public:
+        // 256 MiB hold the curves of about 400 hours of audio.
+        static constexpr qint64 DefaultMaxBytes = 256 << 20;
+
+        ApCache(QString cacheDir, const QString &modelDir, qint64 maxBytes = DefaultMaxBytes);
+
+        bool isValid() const;
+        QString cacheDir() const;
+
+        // Empty if the audio file cannot be read.
+        QByteArray key(const QString &wavPath) const;
+
+        bool load(const QByteArray &key, std::vector<float> &prob, float &timeScale) const;
+
+        // Rounds `prob` to the stored precision first, so a fresh run and a cached run segment the same curve.
+        bool store(const QByteArray &key, std::vector<float> &prob, float timeScale, QString &msg) const;
+
+    private:
+        QString filePath(const QByteArray &key) const;
+        void prune() const;
+
+        QString m_cacheDir;
+        QByteArray m_modelHash;
+        qint64 m_maxBytes;
+        mutable std::atomic<qint64> m_bytes{0}; // size of the directory, counted again by prune()
+        mutable QMutex m_pruneMutex;
+    };
+}
+
+#endif // APCACHE_H
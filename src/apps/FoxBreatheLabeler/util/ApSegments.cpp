@@ -0,0 +1,123 @@
+#include "ApSegments.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace FBL {
+    // Frames per compare block; the mask of one block stays in L1.
+    static constexpr size_t BlockFrames = 1024;
+
+    ApRuns thresholdRuns(const float *prob, const size_t size, const double threshold) {
+        ApRuns res;
+        res.frames = static_cast<int>(size);
+        res.threshold = threshold;
+
+        // Smallest float that is >= threshold, so the float compare below agrees with `prob[i] >= threshold`
+        // evaluated in double.
+        auto floatThreshold = static_cast<float>(threshold);
+        if (static_cast<double>(floatThreshold) < threshold)
+            floatThreshold = std::nextafter(floatThreshold, std::numeric_limits<float>::infinity());
+
+        uint8_t mask[BlockFrames];
+        int runBegin = -1;
+        for (size_t blockBegin = 0; blockBegin < size; blockBegin += BlockFrames) {
+            const size_t count = std::min(BlockFrames, size - blockBegin);
+            const float *block = prob + blockBegin;
+
+            // Branch-free compare, vectorized by the compiler; full blocks get a constant trip count.
+            if (count == BlockFrames) {
+                for (size_t i = 0; i < BlockFrames; ++i)
+                    mask[i] = block[i] >= floatThreshold;
+            } else {
+                for (size_t i = 0; i < count; ++i)
+                    mask[i] = block[i] >= floatThreshold;
+            }
+
+            // Jump from edge to edge instead of testing every frame.
+            const uint8_t *cursor = mask;
+            const uint8_t *blockEnd = mask + count;
+            while (cursor != blockEnd) {
+                const auto edge = static_cast<const uint8_t *>(
+                    std::memchr(cursor, runBegin == -1, static_cast<size_t>(blockEnd - cursor)));
+                if (!edge)
+                    break;
+                const int frame = static_cast<int>(blockBegin + (edge - mask));
+                if (runBegin == -1) {
+                    runBegin = frame;
+                } else {
+                    res.runs.emplace_back(runBegin, frame);
+                    res.values.insert(res.values.end(), prob + runBegin, prob + frame);
+                    runBegin = -1;
+                }
+                cursor = edge;
+            }
+        }
+        if (runBegin != -1) {
+            res.runs.emplace_back(runBegin, res.frames);
+            res.values.insert(res.values.end(), prob + runBegin, prob + size);
+        }
+        return res;
+    }
+
+    ApRuns rethresholdRuns(const ApRuns &runs, const double threshold) {
+        if (threshold <= runs.threshold)
+            return runs;
+
+        // Frames outside the runs are below the old threshold and so below the new one too.
+        ApRuns res;
+        res.frames = runs.frames;
+        res.threshold = threshold;
+        const float *values = runs.values.data();
+        for (const auto &run : runs.runs) {
+            const int length = run.second - run.first;
+            const ApRuns inner = thresholdRuns(values, static_cast<size_t>(length), threshold);
+            for (const auto &innerRun : inner.runs)
+                res.runs.emplace_back(run.first + innerRun.first, run.first + innerRun.second);
+            res.values.insert(res.values.end(), inner.values.begin(), inner.values.end());
+            values += length;
+        }
+        return res;
+    }
+
+    std::vector<std::pair<float, float>> segmentsFromRuns(const ApRuns &runs, const double time_scale,
+                                                          const int max_gap, const int min_frames) {
+        std::vector<std::pair<float, float>> segments;
+        if (runs.runs.empty())
+            return segments;
+
+        int start = runs.runs.front().first;
+        int runEnd = runs.runs.front().second;
+        for (size_t i = 1; i < runs.runs.size(); ++i) {
+            const auto &run = runs.runs[i];
+            if (run.first - runEnd <= max_gap) {
+                runEnd = run.second;
+                continue;
+            }
+            // The segment ends on its last frame above the threshold.
+            const int end = runEnd - 1;
+            if (end - start >= min_frames)
+                segments.emplace_back(start * time_scale, end * time_scale);
+            start = run.first;
+            runEnd = run.second;
+        }
+
+        if (runs.frames - runEnd > max_gap) {
+            const int end = runEnd - 1;
+            if (end - start >= min_frames)
+                segments.emplace_back(start * time_scale, end * time_scale);
+        } else if (runs.frames - start >= min_frames) {
+            // A segment still open at the end of the curve runs to the last frame, trailing gap included.
+            segments.emplace_back(start * time_scale, (runs.frames - 1) * time_scale);
+        }
+        return segments;
+    }
+
+    std::vector<std::pair<float, float>> findSegmentsDynamic(const std::vector<float> &arr, const double time_scale,
+                                                             const double threshold, const int max_gap,
+                                                             const int min_frames) {
+        return segmentsFromRuns(thresholdRuns(arr.data(), arr.size(), threshold), time_scale, max_gap, min_frames);
+    }
+}
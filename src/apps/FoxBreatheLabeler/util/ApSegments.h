@@ -0,0 +1,35 @@
+#ifndef APSEGMENTS_H
+#define APSEGMENTS_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace FBL {
+    // ap_probability frames at or above a threshold, run-length encoded as sorted [begin, end) frame ranges.
+    // Gap merging and the minimum duration only look at the runs, so they can be re-applied without touching
+    // the probabilities again. The probabilities inside the runs are kept as well, which is all a higher
+    // threshold needs.
+    struct ApRuns {
+        std::vector<std::pair<int, int>> runs;
+        std::vector<float> values; // frames of every run, run after run
+        int frames = 0;
+        double threshold = 0;
+    };
+
+    ApRuns thresholdRuns(const float *prob, size_t size, double threshold);
+
+    // Same as thresholdRuns() on the whole curve for any threshold at or above runs.threshold; lower ones cannot
+    // be recovered and give back runs unchanged.
+    ApRuns rethresholdRuns(const ApRuns &runs, double threshold);
+
+    // Merges runs separated by at most max_gap frames and drops segments shorter than min_frames.
+    std::vector<std::pair<float, float>> segmentsFromRuns(const ApRuns &runs, double time_scale, int max_gap = 5,
+                                                          int min_frames = 10);
+
+    std::vector<std::pair<float, float>> findSegmentsDynamic(const std::vector<float> &arr, double time_scale,
+                                                             double threshold = 0.5, int max_gap = 5,
+                                                             int min_frames = 10);
+}
+
+#endif // APSEGMENTS_H
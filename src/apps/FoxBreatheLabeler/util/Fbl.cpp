@@ -1,13 +1,15 @@
 #include "Fbl.h"
 
+#include "ApSegments.h"
+
 #include <QBuffer>
 #include <QDebug>
-#include <QMessageBox>
 
 #include <CDSPResampler.h>
 #include <QDir>
 #include <sndfile.hh>
 
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 #include <vector>
@@ -16,13 +18,14 @@
 
 namespace FBL {
 
-    FBL::FBL(const QString &modelDir, bool useGpu, int deviceIndex, bool *isOk, QString *errorMessage) {
+    FBL::FBL(const QString &modelDir, bool useGpu, int deviceIndex, bool *isOk, QString *errorMessage,
+             int intraOpThreads) {
         const auto modelPath = modelDir + QDir::separator() + "model.onnx";
         const auto configPath = modelDir + QDir::separator() + "config.yaml";
         m_fblModel = std::make_unique<FblModel>();
         std::string modelLoadErrMsg;
         bool isModelLoaded = m_fblModel->load(modelPath.toUtf8().toStdString(), useGpu ? EP_DirectML : EP_CPU,
-                                              deviceIndex, modelLoadErrMsg);
+                                              deviceIndex, modelLoadErrMsg, intraOpThreads);
 
         YAML::Node config = YAML::LoadFile(configPath.toUtf8().toStdString());
 
@@ -32,6 +35,12 @@ namespace FBL {
 
         m_time_scale = 1 / (static_cast<float>(m_audio_sample_rate) / static_cast<float>(m_hop_size));
 
+        // Inference windows are whole hops so window frames line up with the frames of the full file.
+        m_window_samples = static_cast<size_t>(WindowSeconds * m_audio_sample_rate / m_hop_size) * m_hop_size;
+        m_window_overlap = static_cast<size_t>(WindowOverlapSeconds * m_audio_sample_rate / m_hop_size) * m_hop_size;
+        m_bucket_samples =
+            static_cast<size_t>(std::ceil(BucketSeconds * m_audio_sample_rate / m_hop_size)) * m_hop_size;
+
         if (!isModelLoaded) {
             if (isOk) {
                 *isOk = false;
@@ -50,72 +59,241 @@ namespace FBL {
 
     FBL::~FBL() = default;
 
-    static std::vector<std::pair<float, float>> findSegmentsDynamic(const std::vector<float> &arr, double time_scale,
-                                                                    double threshold = 0.5, int max_gap = 5,
-                                                                    int ap_threshold = 10) {
-        std::vector<std::pair<float, float>> segments;
-        int start = -1;
-        int gap_count = 0;
-
-        for (int i = 0; i < arr.size(); ++i) {
-            if (arr[i] >= threshold) {
-                if (start == -1) {
-                    start = i;
-                }
-                gap_count = 0;
+    bool FBL::readWaveform(SF_VIO &sf_vio, std::vector<float> &waveform, QString &msg) const {
+        SndfileHandle sf(sf_vio.vio, &sf_vio.data, SFM_READ, SF_FORMAT_WAV | SF_FORMAT_PCM_16, 1, m_audio_sample_rate);
+
+        const auto frames = sf.frames();
+
+        sf.seek(0, SEEK_SET);
+        waveform.resize(frames);
+        sf.read(waveform.data(), static_cast<sf_count_t>(waveform.size()));
+        return true;
+    }
+
+    bool FBL::loadAudio(const QString &filename, std::vector<float> &waveform, QString &msg) const {
+        auto sf_vio = resample(filename);
+        if (!readWaveform(sf_vio, waveform, msg))
+            return false;
+        if (waveform.empty()) {
+            msg = "Failed to read audio file.";
+            return false;
+        }
+        return true;
+    }
+
+    size_t FBL::paddedLength(const size_t samples) const {
+        return (samples + m_bucket_samples - 1) / m_bucket_samples * m_bucket_samples;
+    }
+
+    bool FBL::forwardBatch(const std::vector<FloatSpan> &inputs, std::vector<std::vector<float>> &probs,
+                           QString &msg) const {
+        size_t max_len = 0;
+        std::vector<size_t> lengths;
+        lengths.reserve(inputs.size());
+        for (const auto &input : inputs) {
+            max_len = std::max(max_len, input.size);
+            lengths.push_back(input.size);
+        }
+
+        // Samples go straight into the model's reused input tensor, zero padded to a whole bucket past the longest
+        // input.
+        const size_t rowLength = paddedLength(max_len);
+        float *tensor = m_fblModel->prepareInput(inputs.size(), rowLength);
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            float *row = tensor + i * rowLength;
+            std::copy(inputs[i].data, inputs[i].data + inputs[i].size, row);
+            std::fill(row + inputs[i].size, row + rowLength, 0.0f);
+        }
+        return runBatch(lengths, rowLength, probs, msg);
+    }
+
+    bool FBL::runBatch(const std::vector<size_t> &lengths, const size_t rowLength,
+                       std::vector<std::vector<float>> &probs, QString &msg) const {
+        std::string modelMsg;
+        FloatSpan modelRes;
+        if (!m_fblModel->forward(modelRes, modelMsg)) {
+            msg = QString::fromStdString(modelMsg);
+            return false;
+        }
+
+        // Every row of the output covers the padded row; frames past an input's own length only cover zero padding
+        // and are dropped.
+        const size_t rowFrames = modelRes.size / lengths.size();
+        probs.clear();
+        probs.reserve(lengths.size());
+        for (size_t i = 0; i < lengths.size(); ++i) {
+            const size_t validFrames =
+                rowLength == 0 ? 0 : std::min(rowFrames, (lengths[i] * rowFrames + rowLength - 1) / rowLength);
+            const float *row = modelRes.data + i * rowFrames;
+            probs.emplace_back(row, row + validFrames);
+        }
+        return true;
+    }
+
+    bool FBL::forwardWindowed(const std::vector<float> &waveform, std::vector<float> &prob, QString &msg) const {
+        const size_t window = m_window_samples;
+        const size_t step = m_window_samples - m_window_overlap;
+
+        std::vector<float> sum;
+        std::vector<int> count;
+        for (size_t start = 0; start < waveform.size(); start += step) {
+            const size_t end = std::min(waveform.size(), start + window);
+            std::vector<std::vector<float>> chunkProbs;
+            if (!forwardBatch({FloatSpan{waveform.data() + start, end - start}}, chunkProbs, msg)) {
+                return false;
+            }
+
+            // Window starts are hop aligned, so window frame k is frame start / hop + k of the whole file.
+            const auto &chunk = chunkProbs.front();
+            const size_t offset = start / m_hop_size;
+            if (sum.size() < offset + chunk.size()) {
+                sum.resize(offset + chunk.size(), 0.0f);
+                count.resize(offset + chunk.size(), 0);
+            }
+            for (size_t k = 0; k < chunk.size(); ++k) {
+                sum[offset + k] += chunk[k];
+                count[offset + k]++;
+            }
+
+            if (end == waveform.size())
+                break;
+        }
+
+        prob.resize(sum.size());
+        for (size_t k = 0; k < sum.size(); ++k) {
+            prob[k] = count[k] > 0 ? sum[k] / static_cast<float>(count[k]) : 0.0f;
+        }
+        return true;
+    }
+
+    float FBL::timeScale() const {
+        return m_time_scale;
+    }
+
+    bool FBL::forward(const std::vector<std::vector<float>> &waveforms, std::vector<std::vector<float>> &probs,
+                      QString &msg) const {
+        if (!m_fblModel || !m_fblModel->isLoaded()) {
+            return false;
+        }
+
+        const bool hasLong = std::any_of(waveforms.begin(), waveforms.end(), [this](const std::vector<float> &w) {
+            return w.size() > m_window_samples;
+        });
+
+        probs.clear();
+        if (!hasLong) {
+            std::vector<FloatSpan> inputs;
+            inputs.reserve(waveforms.size());
+            for (const auto &waveform : waveforms) {
+                inputs.push_back({waveform.data(), waveform.size()});
+            }
+            if (!forwardBatch(inputs, probs, msg))
+                return false;
+        } else {
+            // Long takes are inferred window by window so the input tensor never exceeds one window.
+            probs.resize(waveforms.size());
+            for (size_t i = 0; i < waveforms.size(); ++i) {
+                if (!forwardWindowed(waveforms[i], probs[i], msg))
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool FBL::forward(const QStringList &filenames, std::vector<std::vector<float>> &probs,
+                      std::vector<QString> &errors, QString &msg) const {
+        if (!m_fblModel || !m_fblModel->isLoaded()) {
+            return false;
+        }
+
+        const auto count = static_cast<size_t>(filenames.size());
+        probs.assign(count, {});
+        errors.assign(count, {});
+
+        std::vector<size_t> lengths(count, 0);
+        std::vector<size_t> batch;
+        size_t max_len = 0;
+        for (size_t i = 0; i < count; ++i) {
+            lengths[i] = resampledLength(filenames[i]);
+            if (lengths[i] == 0) {
+                errors[i] = "Failed to read audio file.";
+            } else if (lengths[i] > m_window_samples) {
+                // Long takes are inferred window by window from the whole waveform.
+                std::vector<float> waveform;
+                if (loadAudio(filenames[i], waveform, errors[i]) && !forwardWindowed(waveform, probs[i], msg))
+                    return false;
             } else {
-                if (start != -1) {
-                    if (gap_count < max_gap) {
-                        gap_count++;
-                    } else {
-                        const int end = i - gap_count - 1;
-                        if (end >= start && (end - start) >= ap_threshold) {
-                            segments.emplace_back(start * time_scale, end * time_scale);
-                        }
-                        start = -1;
-                        gap_count = 0;
-                    }
-                }
+                batch.push_back(i);
+                max_len = std::max(max_len, lengths[i]);
             }
         }
+        if (batch.empty()) {
+            return true;
+        }
 
-        // Handle the case where the array ends with a segment
-        if (start != -1 && (arr.size() - start) >= ap_threshold) {
-            segments.emplace_back(start * time_scale, (arr.size() - 1) * time_scale);
+        const size_t rowLength = paddedLength(max_len);
+        float *tensor = m_fblModel->prepareInput(batch.size(), rowLength);
+        std::vector<size_t> rowLengths;
+        rowLengths.reserve(batch.size());
+        for (size_t k = 0; k < batch.size(); ++k) {
+            float *row = tensor + k * rowLength;
+            const size_t written = resampleInto(filenames[static_cast<int>(batch[k])], row, lengths[batch[k]]);
+            std::fill(row + written, row + rowLength, 0.0f);
+            if (written == 0) {
+                errors[batch[k]] = "Failed to read audio file.";
+            }
+            rowLengths.push_back(written);
         }
 
-        return segments;
+        std::vector<std::vector<float>> batchProbs;
+        if (!runBatch(rowLengths, rowLength, batchProbs, msg))
+            return false;
+        for (size_t k = 0; k < batch.size(); ++k) {
+            if (errors[batch[k]].isEmpty()) {
+                probs[batch[k]] = std::move(batchProbs[k]);
+            }
+        }
+        return true;
     }
 
-    bool FBL::recognize(SF_VIO sf_vio, std::vector<std::pair<float, float>> &res, QString &msg, float ap_threshold,
+    bool FBL::recognize(const std::vector<std::vector<float>> &waveforms,
+                        std::vector<std::vector<std::pair<float, float>>> &res, QString &msg, float ap_threshold,
                         float ap_dur) const {
         if (!m_fblModel || !m_fblModel->isLoaded()) {
             return false;
         }
-        SndfileHandle sf(sf_vio.vio, &sf_vio.data, SFM_READ, SF_FORMAT_WAV | SF_FORMAT_PCM_16, 1, m_audio_sample_rate);
 
-        const auto frames = sf.frames();
+        std::vector<std::vector<float>> probs;
+        if (!forward(waveforms, probs, msg))
+            return false;
 
-        SF_VIO sfChunk;
-        sf.seek(0, SEEK_SET);
-        std::vector<float> tmp(frames);
-        sf.read(tmp.data(), static_cast<sf_count_t>(tmp.size()));
+        res.clear();
+        res.reserve(probs.size());
+        for (const auto &apProbability : probs) {
+            res.push_back(findSegmentsDynamic(apProbability, m_time_scale, ap_threshold, 5,
+                                              static_cast<int>(ap_dur / m_time_scale)));
+        }
+        return true;
+    }
 
-        if (static_cast<double>(frames) / m_audio_sample_rate > 60) {
-            msg = "The audio contains continuous pronunciation segments that exceed 60 seconds. Please manually "
-                  "segment and rerun the recognition program.";
+    bool FBL::recognize(SF_VIO sf_vio, std::vector<std::pair<float, float>> &res, QString &msg, float ap_threshold,
+                        float ap_dur) const {
+        if (!m_fblModel || !m_fblModel->isLoaded()) {
             return false;
         }
 
-        std::string modelMsg;
-        std::vector<float> modelRes;
-        if (m_fblModel->forward(std::vector<std::vector<float>>{tmp}, modelRes, modelMsg)) {
-            res = findSegmentsDynamic(modelRes, m_time_scale, ap_threshold, 5, static_cast<int>(ap_dur / m_time_scale));
-            return true;
-        } else {
-            msg = QString::fromStdString(modelMsg);
+        std::vector<float> tmp;
+        if (!readWaveform(sf_vio, tmp, msg)) {
+            return false;
+        }
+
+        std::vector<std::vector<std::pair<float, float>>> batchRes;
+        if (!recognize(std::vector<std::vector<float>>{std::move(tmp)}, batchRes, msg, ap_threshold, ap_dur)) {
             return false;
         }
+        res = std::move(batchRes.front());
+        return true;
     }
 
     bool FBL::recognize(const QString &filename, std::vector<std::pair<float, float>> &res, QString &msg,
@@ -124,13 +302,6 @@ namespace FBL {
     }
 
     SF_VIO FBL::resample(const QString &filename) const {
-        // 读取WAV文件头信息
-        SndfileHandle srcHandle(filename.toLocal8Bit(), SFM_READ, SF_FORMAT_WAV);
-        if (!srcHandle) {
-            qDebug() << "Failed to open WAV file:" << sf_strerror(nullptr);
-            return {};
-        }
-
         // 临时文件
         SF_VIO sf_vio;
         SndfileHandle outBuf(sf_vio.vio, &sf_vio.data, SFM_WRITE, SF_FORMAT_WAV | SF_FORMAT_PCM_16, 1,
@@ -140,15 +311,56 @@ namespace FBL {
             return {};
         }
 
+        const bool ok = resample(filename, [&outBuf](const double *samples, const int count) {
+            // 写入输出文件
+            if (outBuf.write(samples, count) != count) {
+                qDebug() << "Error writing to output file";
+                return false;
+            }
+            return true;
+        });
+        return ok ? sf_vio : SF_VIO{};
+    }
+
+    size_t FBL::resampledLength(const QString &filename) const {
+        const SndfileHandle srcHandle(filename.toLocal8Bit(), SFM_READ, SF_FORMAT_WAV);
+        if (!srcHandle || srcHandle.samplerate() <= 0) {
+            return 0;
+        }
+        return static_cast<size_t>(static_cast<double>(srcHandle.frames()) /
+                                   static_cast<double>(srcHandle.samplerate()) * m_audio_sample_rate);
+    }
+
+    size_t FBL::resampleInto(const QString &filename, float *out, const size_t length) const {
+        size_t written = 0;
+        resample(filename, [&](const double *samples, const int count) {
+            const size_t n = std::min(length - written, static_cast<size_t>(std::max(count, 0)));
+            // Same range as the 16-bit round trip of loadAudio()
+            std::transform(samples, samples + n, out + written,
+                           [](const double sample) { return static_cast<float>(std::clamp(sample, -1.0, 1.0)); });
+            written += n;
+            return written < length;
+        });
+        return written;
+    }
+
+    bool FBL::resample(const QString &filename, const std::function<bool(const double *, int)> &sink) const {
+        // 读取WAV文件头信息
+        SndfileHandle srcHandle(filename.toLocal8Bit(), SFM_READ, SF_FORMAT_WAV);
+        if (!srcHandle) {
+            qDebug() << "Failed to open WAV file:" << sf_strerror(nullptr);
+            return false;
+        }
+
         // 创建 CDSPResampler 对象
         r8b::CDSPResampler16 resampler(srcHandle.samplerate(), m_audio_sample_rate, srcHandle.samplerate());
 
-        // 重采样并写入输出文件
+        // 重采样并写入输出
         double *op0;
         std::vector<double> tmp(srcHandle.samplerate() * srcHandle.channels());
         double total = 0;
 
-        // 逐块读取、重采样并写入输出文件
+        // 逐块读取、重采样并写入输出
         while (true) {
             const auto bytesRead = srcHandle.read(tmp.data(), static_cast<sf_count_t>(tmp.size()));
             if (bytesRead <= 0) {
@@ -165,24 +377,20 @@ namespace FBL {
             const int outSamples =
                 resampler.process(inputBuf.data(), static_cast<int>(bytesRead) / srcHandle.channels(), op0);
 
-            // 写入输出文件
-            const auto bytesWritten = static_cast<double>(outBuf.write(op0, outSamples));
-
-            if (bytesWritten != outSamples) {
-                qDebug() << "Error writing to output file";
-                break;
+            if (!sink(op0, outSamples)) {
+                return true;
             }
-            total += bytesWritten;
+            total += outSamples;
         }
 
         if (const int endSize = static_cast<int>(static_cast<double>(srcHandle.frames()) /
                                                      static_cast<double>(srcHandle.samplerate()) * m_audio_sample_rate -
-                                                 total)) {
+                                                 total);
+            endSize > 0) {
             std::vector<double> inputBuf(tmp.size() / srcHandle.channels());
-            resampler.process(inputBuf.data(), srcHandle.samplerate(), op0);
-            outBuf.write(op0, endSize);
+            const int outSamples = resampler.process(inputBuf.data(), srcHandle.samplerate(), op0);
+            sink(op0, std::min(endSize, outSamples));
         }
-
-        return sf_vio;
+        return true;
     }
-} // LyricFA
\ No newline at end of file
+} // LyricFA
@@ -1,9 +1,11 @@
 #ifndef ASR_H
 #define ASR_H
 
+#include <functional>
 #include <memory>
 
 #include <QString>
+#include <QStringList>
 
 #include "FblModel.h"
 
@@ -13,7 +15,8 @@ namespace FBL {
 
     class FBL {
     public:
-        explicit FBL(const QString &modelDir, bool useGpu = false, int deviceIndex = 0, bool *isOk = nullptr, QString *errorMessage = nullptr);
+        explicit FBL(const QString &modelDir, bool useGpu = false, int deviceIndex = 0, bool *isOk = nullptr,
+                     QString *errorMessage = nullptr, int intraOpThreads = 0);
         ~FBL();
 
         [[nodiscard]] bool recognize(const QString &filename, std::vector<std::pair<float, float>> &res, QString &msg,
@@ -21,8 +24,45 @@ namespace FBL {
         [[nodiscard]] bool recognize(SF_VIO sf_vio, std::vector<std::pair<float, float>> &res, QString &msg,
                                      float ap_threshold = 0.4, float ap_dur = 0.08) const;
 
+        // Resamples and decodes a file into the mono waveform expected by the model.
+        [[nodiscard]] bool loadAudio(const QString &filename, std::vector<float> &waveform, QString &msg) const;
+
+        // Runs all waveforms through one ORT call ([batch, max_len] padded to whole seconds) and splits the result.
+        // Inputs longer than one window (60 s) are instead inferred in overlapping windows whose ap_probability
+        // is averaged, so shorter inputs give exactly the same result as a single pass.
+        [[nodiscard]] bool recognize(const std::vector<std::vector<float>> &waveforms,
+                                     std::vector<std::vector<std::pair<float, float>>> &res, QString &msg,
+                                     float ap_threshold = 0.4, float ap_dur = 0.08) const;
+
+        // Model output only: the ap_probability curve of every waveform, one frame per timeScale() seconds.
+        [[nodiscard]] bool forward(const std::vector<std::vector<float>> &waveforms,
+                                   std::vector<std::vector<float>> &probs, QString &msg) const;
+        // Same for audio files, which are resampled straight into the model input. A file that cannot be read gets
+        // an empty curve and its message in `errors`; false means the inference itself failed.
+        [[nodiscard]] bool forward(const QStringList &filenames, std::vector<std::vector<float>> &probs,
+                                   std::vector<QString> &errors, QString &msg) const;
+        [[nodiscard]] float timeScale() const;
+
     private:
         [[nodiscard]] SF_VIO resample(const QString &filename) const;
+        // Streams the mono samples of a file at the model rate to sink until it returns false.
+        bool resample(const QString &filename, const std::function<bool(const double *, int)> &sink) const;
+        [[nodiscard]] size_t resampledLength(const QString &filename) const;
+        [[nodiscard]] size_t resampleInto(const QString &filename, float *out, size_t length) const;
+        // Input rows are padded to whole buckets so the model sees a few shapes only.
+        [[nodiscard]] size_t paddedLength(size_t samples) const;
+        [[nodiscard]] bool readWaveform(SF_VIO &sf_vio, std::vector<float> &waveform, QString &msg) const;
+        [[nodiscard]] bool forwardBatch(const std::vector<FloatSpan> &inputs, std::vector<std::vector<float>> &probs,
+                                        QString &msg) const;
+        // Runs the filled input tensor, rows of rowLength samples of which the first lengths[i] are audio.
+        [[nodiscard]] bool runBatch(const std::vector<size_t> &lengths, size_t rowLength,
+                                    std::vector<std::vector<float>> &probs, QString &msg) const;
+        [[nodiscard]] bool forwardWindowed(const std::vector<float> &waveform, std::vector<float> &prob,
+                                           QString &msg) const;
+
+        static constexpr double WindowSeconds = 60;
+        static constexpr double WindowOverlapSeconds = 5;
+        static constexpr double BucketSeconds = 1;
 
         std::unique_ptr<FblModel> m_fblModel;
 
@@ -30,6 +70,10 @@ namespace FBL {
         int m_hop_size;
 
         float m_time_scale;
+
+        size_t m_window_samples;
+        size_t m_window_overlap;
+        size_t m_bucket_samples;
     };
 } // LyricFA
 
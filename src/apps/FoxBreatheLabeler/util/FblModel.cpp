@@ -3,6 +3,8 @@
 
 #include <syscmdline/system.h>
 
+#include <algorithm>
+
 namespace FBL {
     FblModel::FblModel()
         : m_env(Ort::Env(ORT_LOGGING_LEVEL_WARNING, "FblModel")),
@@ -14,9 +16,13 @@ namespace FBL {
 
     FblModel::~FblModel() = default;
 
-    bool FblModel::load(const std::string &model_path, ExecutionProvider ep, int deviceIndex, std::string &msg) {
+    bool FblModel::load(const std::string &model_path, ExecutionProvider ep, int deviceIndex, std::string &msg,
+                        int intraOpThreads) {
         try {
             Ort::SessionOptions sessionOptions;
+            if (intraOpThreads > 0) {
+                sessionOptions.SetIntraOpNumThreads(intraOpThreads);
+            }
             std::string errorMessage;
             switch (ep) {
                 case EP_CUDA:
@@ -34,11 +40,14 @@ namespace FBL {
                 default:
                     break;
             }
+            // Bindings and learned output shapes belong to the previous session.
+            m_binding.reset();
+            m_outputShapes.clear();
 #ifdef _WIN32
             const std::wstring wstrPath = SysCmdLine::utf8ToWide(model_path);
             m_session = Ort::Session(m_env, wstrPath.c_str(), sessionOptions);
 #else
-            m_session = Ort::Session(m_env, model_path.c_str(), m_session_options);
+            m_session = Ort::Session(m_env, model_path.c_str(), sessionOptions);
 #endif
             // Check if input/output names match
             bool isModelValid = true;
@@ -68,45 +77,81 @@ namespace FBL {
     }
 
     void FblModel::unload() {
+        m_binding.reset();
+        m_outputShapes.clear();
         m_session = Ort::Session(nullptr);
     }
 
-    bool FblModel::forward(const std::vector<std::vector<float>> &input_data, std::vector<float> &result,
-                           std::string &msg) {
-        const size_t batch_size = input_data.size();
-        if (batch_size == 0) {
+    float *FblModel::prepareInput(const size_t batch, const size_t samples) {
+        if (m_input.size() < batch * samples) {
+            m_input.resize(batch * samples);
+        }
+        m_inputShape = {static_cast<int64_t>(batch), static_cast<int64_t>(samples)};
+        return m_input.data();
+    }
+
+    bool FblModel::forward(FloatSpan &result, std::string &msg) {
+        const size_t inputSize = static_cast<size_t>(m_inputShape[0] * m_inputShape[1]);
+        if (inputSize == 0) {
             msg = "输入数据不能为空。";
             return false;
         }
 
-        // 确定输入数据中最大的长度
-        size_t max_height = 0;
-        for (const auto &channel_data : input_data) {
-            max_height = std::max(max_height, channel_data.size());
-        }
+        try {
+            if (!m_binding) {
+                m_binding = std::make_unique<Ort::IoBinding>(m_session);
+            }
 
-        // 创建一个用于存放扁平化后的输入数据的向量
-        std::vector<float> flattened_input(batch_size * max_height, 0.0f);
+            const Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
+                m_memoryInfo, m_input.data(), inputSize, m_inputShape.data(), m_inputShape.size());
+            m_binding->BindInput(m_input_name, input_tensor);
 
-        // 将输入数据扁平化并填充到flattened_input中
-        for (size_t i = 0; i < batch_size; ++i) {
-            std::copy(input_data[i].begin(), input_data[i].end(), flattened_input.begin() + i * max_height);
-        }
+            const auto shapeIt = m_outputShapes.find(m_inputShape[1]);
+            if (shapeIt != m_outputShapes.end()) {
+                // Sample count seen before: ORT writes straight into the reused output buffer.
+                auto shape = shapeIt->second;
+                shape[0] = m_inputShape[0];
+                size_t outputSize = 1;
+                for (const auto dim : shape) {
+                    outputSize *= static_cast<size_t>(dim);
+                }
+                if (m_output.size() < outputSize) {
+                    m_output.resize(outputSize);
+                }
+                const Ort::Value output_tensor = Ort::Value::CreateTensor<float>(
+                    m_memoryInfo, m_output.data(), outputSize, shape.data(), shape.size());
+                m_binding->BindOutput(m_output_name, output_tensor);
+                m_session.Run(Ort::RunOptions{nullptr}, *m_binding);
+                m_binding->SynchronizeOutputs();
 
-        // 定义输入张量的形状
-        const std::array<int64_t, 2> input_shape_{static_cast<int64_t>(batch_size), static_cast<int64_t>(max_height)};
+                result = {m_output.data(), outputSize};
+                return true;
+            }
 
-        // 创建输入张量
-        const Ort::Value input_tensor = Ort::Value::CreateTensor<float>(
-            m_memoryInfo, flattened_input.data(), flattened_input.size(), input_shape_.data(), input_shape_.size());
+            // New sample count: let ORT allocate once and remember the shape for the next call.
+            m_binding->BindOutput(m_output_name, m_memoryInfo);
+            m_session.Run(Ort::RunOptions{nullptr}, *m_binding);
+            m_binding->SynchronizeOutputs();
 
-        try {
-            auto output_tensors =
-                m_session.Run(Ort::RunOptions{nullptr}, &m_input_name, &input_tensor, 1, &m_output_name, 1);
+            auto output_tensors = m_binding->GetOutputValues();
+            const auto info = output_tensors.front().GetTensorTypeAndShapeInfo();
+            const size_t outputSize = info.GetElementCount();
+            const float *float_array = output_tensors.front().GetTensorData<float>();
+            if (m_output.size() < outputSize) {
+                m_output.resize(outputSize);
+            }
+            std::copy(float_array, float_array + outputSize, m_output.begin());
+
+            // Padded sample counts are few, the cap only guards against callers that do not pad.
+            auto shape = info.GetShape();
+            if (!shape.empty() && shape[0] == m_inputShape[0]) {
+                if (m_outputShapes.size() >= MaxOutputShapes) {
+                    m_outputShapes.clear();
+                }
+                m_outputShapes.emplace(m_inputShape[1], std::move(shape));
+            }
 
-            const float *float_array = output_tensors.front().GetTensorMutableData<float>();
-            result = std::vector<float>(
-                float_array, float_array + output_tensors.front().GetTensorTypeAndShapeInfo().GetElementCount());
+            result = {m_output.data(), outputSize};
             return true;
         } catch (const Ort::Exception &e) {
             msg = "Error during model inference: " + std::string(e.what());
@@ -2,7 +2,12 @@
 #define FBLMODEL_H
 
 #include <onnxruntime_cxx_api.h>
+
+#include <array>
+#include <map>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 namespace FBL {
 
@@ -12,16 +17,31 @@ namespace FBL {
         EP_CUDA = 3,
     };
 
+    // Non-owning view of contiguous floats.
+    struct FloatSpan {
+        const float *data = nullptr;
+        size_t size = 0;
+    };
+
     class FblModel {
     public:
         FblModel();
         ~FblModel();
-        bool load(const std::string &model_path, ExecutionProvider ep, int deviceIndex, std::string &msg);
+        // intraOpThreads <= 0 keeps the ORT default (all cores).
+        bool load(const std::string &model_path, ExecutionProvider ep, int deviceIndex, std::string &msg,
+                  int intraOpThreads = 0);
         void unload();
-        bool forward(const std::vector<std::vector<float>> &input_data, std::vector<float> &result,
-                     std::string &msg);
         bool isLoaded() const;
 
+        // Returns the [batch, samples] input tensor to be filled by the caller, padding included. The buffer is
+        // reused by every call and only grows, to the largest input seen. Callers pad samples to a few fixed lengths
+        // so that the output shape of every call is known in advance.
+        float *prepareInput(size_t batch, size_t samples);
+
+        // Runs the prepared input through an IO binding. `result` points into a buffer owned by the model and stays
+        // valid until the next prepareInput() or forward().
+        bool forward(FloatSpan &result, std::string &msg);
+
     private:
         Ort::Env m_env;
         Ort::Session m_session;
@@ -29,6 +49,16 @@ namespace FBL {
         const char *m_input_name;
         const char *m_output_name;
 
+        static constexpr size_t MaxOutputShapes = 64;
+
+        std::unique_ptr<Ort::IoBinding> m_binding;
+        std::vector<float> m_input;
+        std::vector<float> m_output;
+        std::array<int64_t, 2> m_inputShape{0, 0};
+        // Output shape by input sample count, learned from the first run of each count. The frame count only depends
+        // on the samples, so any batch size with a known count gets its output bound to m_output directly.
+        std::map<int64_t, std::vector<int64_t>> m_outputShapes;
+
 #ifdef _WIN_X86
         Ort::MemoryInfo m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtDeviceAllocator, OrtMemTypeCPU);
 #else
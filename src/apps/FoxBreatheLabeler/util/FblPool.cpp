@@ -0,0 +1,61 @@
+#include "FblPool.h"
+
+#include <QThread>
+
+#include <algorithm>
+
+namespace FBL {
+    FblPool::FblPool(QString modelDir, const bool useGpu, const int deviceIndex)
+        : m_modelDir(std::move(modelDir)), m_useGpu(useGpu), m_deviceIndex(deviceIndex) {
+    }
+
+    FblPool::~FblPool() {
+        clear();
+    }
+
+    void FblPool::clear() {
+        QMutexLocker locker(&m_mutex);
+        qDeleteAll(m_all);
+        m_all.clear();
+        m_free.clear();
+    }
+
+    bool FblPool::init(const int workers, QString &msg) {
+        if (workers == size())
+            return true;
+
+        clear();
+
+        const int intraOpThreads = m_useGpu ? 0 : std::max(1, QThread::idealThreadCount() / std::max(1, workers));
+        for (int i = 0; i < workers; i++) {
+            bool isOk = false;
+            const auto fbl = new FBL(m_modelDir, m_useGpu, m_deviceIndex, &isOk, &msg, intraOpThreads);
+            if (!isOk) {
+                delete fbl;
+                clear();
+                return false;
+            }
+            QMutexLocker locker(&m_mutex);
+            m_all.append(fbl);
+            m_free.append(fbl);
+        }
+        return true;
+    }
+
+    int FblPool::size() const {
+        return m_all.size();
+    }
+
+    FBL *FblPool::acquire() {
+        QMutexLocker locker(&m_mutex);
+        while (m_free.isEmpty())
+            m_available.wait(&m_mutex);
+        return m_free.takeLast();
+    }
+
+    void FblPool::release(FBL *fbl) {
+        QMutexLocker locker(&m_mutex);
+        m_free.append(fbl);
+        m_available.wakeOne();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef FBLPOOL_H
+#define FBLPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include "Fbl.h"
+
+namespace FBL {
+    // A fixed set of FBL instances, each with its own ORT session. Worker threads borrow one for the duration of
+    // a batch, so sessions are never shared between threads.
+    class FblPool {
+    public:
+        FblPool(QString modelDir, bool useGpu, int deviceIndex);
+        ~FblPool();
+
+        // (Re)creates the sessions for the given number of workers. On CPU the cores are split between the
+        // sessions instead of every session spawning a full set of intra-op threads.
+        bool init(int workers, QString &msg);
+        int size() const;
+
+        FBL *acquire();
+        void release(FBL *fbl);
+
+    private:
+        void clear();
+
+        QString m_modelDir;
+        bool m_useGpu;
+        int m_deviceIndex;
+
+        QList<FBL *> m_all;
+        QList<FBL *> m_free;
+        QMutex m_mutex;
+        QWaitCondition m_available;
+    };
+}
+
+#endif // FBLPOOL_H
@@ -1,17 +1,46 @@
 #include "FblThread.h"
 
+#include <QElapsedTimer>
 #include <QMSystem.h>
-#include <QMessageBox>
 
+#include "ApSegments.h"
 #include "textgrid.hpp"
 
-#include <sstream>
+#include <algorithm>
+#include <string_view>
 
 namespace FBL {
-    FblThread::FblThread(FBL *fbl, QString filename, QString wavPath, QString rawTgPath, QString outTgPath,
-                         float ap_threshold, float ap_dur, float sp_dur)
-        : m_asr(fbl), m_filename(std::move(filename)), m_wavPath(std::move(wavPath)), m_rawTgPath(std::move(rawTgPath)),
-          m_outTgPath(std::move(outTgPath)), ap_threshold(ap_threshold), ap_dur(ap_dur), sp_dur(sp_dur) {
+    FblThread::FblThread(FblPool *pool, QList<FblTask> tasks, float ap_threshold, float ap_dur, float sp_dur,
+                         const ApCache *cache)
+        : m_pool(pool), m_cache(cache), m_tasks(std::move(tasks)), ap_threshold(ap_threshold), ap_dur(ap_dur),
+          sp_dur(sp_dur) {
+    }
+
+    QList<QList<FblTask>> FblThread::makeBatches(QList<FblTask> tasks, const int maxBatchSize,
+                                                 const double maxBatchSeconds) {
+        for (auto &task : tasks) {
+            // Header only, no samples are decoded here.
+            const SndfileHandle sf(task.wavPath.toLocal8Bit());
+            task.duration = sf && sf.samplerate() > 0 ? static_cast<double>(sf.frames()) / sf.samplerate() : 0;
+        }
+
+        std::stable_sort(tasks.begin(), tasks.end(),
+                         [](const FblTask &a, const FblTask &b) { return a.duration < b.duration; });
+
+        QList<QList<FblTask>> batches;
+        QList<FblTask> batch;
+        for (const auto &task : tasks) {
+            // Sorted ascending, so the new task is the longest of the batch and sets the padded length.
+            const double padded = static_cast<double>(batch.size() + 1) * task.duration;
+            if (!batch.isEmpty() && (batch.size() >= maxBatchSize || padded > maxBatchSeconds)) {
+                batches.append(batch);
+                batch.clear();
+            }
+            batch.append(task);
+        }
+        if (!batch.isEmpty())
+            batches.append(batch);
+        return batches;
     }
 
     struct Phone {
@@ -21,22 +50,28 @@ namespace FBL {
     struct Word {
         double start{}, end{};
         std::string text;
-        QList<Phone> phones;
+        std::vector<Phone> phones;
     };
 
+    // `segments` must be sorted. `first` is moved past segments that end before `start`; as callers query with
+    // non-decreasing starts, one sweep over a whole file stays linear in words + segments.
     static std::vector<std::pair<float, float>>
         find_overlapping_segments(double start, double end, const std::vector<std::pair<float, float>> &segments,
-                                  float sp_dur = 0.1) {
+                                  size_t &first, float sp_dur = 0.1) {
         std::vector<std::pair<float, float>> overlapping_segments;
         std::vector<std::pair<float, float>> merged_segments;
 
-        // Find overlapping segments
-        for (const auto &segment : segments) {
-            float segment_start = segment.first;
-            float segment_end = segment.second;
+        while (first < segments.size() && segments[first].second <= start) {
+            first++;
+        }
+
+        // Find overlapping segments; sorted by start, so nothing past the first one starting after `end` can overlap
+        for (size_t i = first; i < segments.size() && !(segments[i].first >= end); ++i) {
+            float segment_start = segments[i].first;
+            float segment_end = segments[i].second;
             // Check if there is any overlap
             if (!(segment_end <= start || segment_start >= end)) {
-                overlapping_segments.push_back(segment);
+                overlapping_segments.push_back(segments[i]);
             }
         }
 
@@ -44,9 +79,6 @@ namespace FBL {
             return overlapping_segments;
         }
 
-        // Sort the overlapping segments based on their start time
-        std::sort(overlapping_segments.begin(), overlapping_segments.end());
-
         // Merge adjacent segments if the gap is less than sp_dur
         float current_start = overlapping_segments[0].first;
         float current_end = overlapping_segments[0].second;
@@ -72,114 +104,245 @@ namespace FBL {
         return merged_segments;
     }
 
+    static bool intervalLess(const textgrid::Interval &a, const textgrid::Interval &b) {
+        return a.min_time < b.min_time;
+    }
+
     void FblThread::run() {
-        QString fblMsg;
-        std::vector<std::pair<float, float>> segment;
-        const auto fblRes = m_asr->recognize(m_wavPath, segment, fblMsg, ap_threshold, ap_dur);
+        QElapsedTimer timer;
+
+        const auto count = static_cast<size_t>(m_tasks.size());
+        std::vector<std::vector<float>> probs(count);
+        std::vector<float> timeScales(count, 0);
+        std::vector<qint64> elapsed(count, 0);
+        std::vector<bool> ready(count, false);
+        QList<QByteArray> keys;
+        QList<int> misses;
+        for (int i = 0; i < m_tasks.size(); i++) {
+            timer.start();
+            keys.append(m_cache ? m_cache->key(m_tasks[i].wavPath) : QByteArray());
+            if (m_cache && m_cache->load(keys[i], probs[i], timeScales[i]))
+                ready[i] = true;
+            else
+                misses.append(i);
+            elapsed[i] = timer.elapsed();
+        }
 
-        if (!fblRes) {
-            Q_EMIT this->oneFailed(m_filename, fblMsg);
-            return;
+        if (!misses.isEmpty()) {
+            // The session is only held for decoding and inference, TextGrid IO below runs without it.
+            FBL *fbl = m_pool->acquire();
+
+            // Files are resampled straight into the batch input, so decoding and inference are timed together.
+            QStringList wavPaths;
+            for (const int i : misses) {
+                wavPaths.append(m_tasks[i].wavPath);
+            }
+
+            timer.start();
+            QString fblMsg;
+            std::vector<std::vector<float>> missProbs;
+            std::vector<QString> loadErrors;
+            const bool fblRes = fbl->forward(wavPaths, missProbs, loadErrors, fblMsg);
+            const float timeScale = fbl->timeScale();
+            m_pool->release(fbl);
+            const qint64 inferMs = timer.elapsed();
+
+            for (int k = 0; k < misses.size(); k++) {
+                const int i = misses[k];
+                elapsed[i] += inferMs;
+                if (!fblRes) {
+                    Q_EMIT this->oneFailed(m_tasks[i].filename, fblMsg, elapsed[i]);
+                    continue;
+                }
+                if (!loadErrors[k].isEmpty()) {
+                    Q_EMIT this->oneFailed(m_tasks[i].filename, loadErrors[k], elapsed[i]);
+                    continue;
+                }
+                probs[i] = std::move(missProbs[k]);
+                timeScales[i] = timeScale;
+                ready[i] = true;
+                if (m_cache) {
+                    // A failed store only costs the next run an inference, the file itself is still labeled.
+                    QString cacheMsg;
+                    timer.start();
+                    m_cache->store(keys[i], probs[i], timeScale, cacheMsg);
+                    elapsed[i] += timer.elapsed();
+                }
+            }
         }
 
-        QFile file(m_rawTgPath);
-        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            fblMsg = QString("Cannot open file: filename = ") + m_rawTgPath + ", error = " + file.errorString();
-            Q_EMIT this->oneFailed(m_filename, fblMsg);
-            return;
+        for (int i = 0; i < m_tasks.size(); i++) {
+            if (!ready[i])
+                continue; // already reported as failed
+            const auto &task = m_tasks[i];
+            timer.start();
+            const auto segments = findSegmentsDynamic(probs[i], timeScales[i], ap_threshold, 5,
+                                                      static_cast<int>(ap_dur / timeScales[i]));
+            QString msg;
+            const bool ok = writeTextGrid(task, segments, msg);
+            elapsed[i] += timer.elapsed();
+            if (ok)
+                Q_EMIT this->oneFinished(task.filename, msg, elapsed[i]);
+            else
+                Q_EMIT this->oneFailed(task.filename, msg, elapsed[i]);
         }
+    }
 
-        QTextStream in(&file);
-        std::string fileContent = in.readAll().toStdString();
+    bool FblThread::writeTextGrid(const FblTask &task, const std::vector<std::pair<float, float>> &segment,
+                                  QString &msg) {
+        QFile file(task.rawTgPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            msg = QString("Cannot open file: filename = ") + task.rawTgPath + ", error = " + file.errorString();
+            return false;
+        }
 
-        textgrid::TextGrid textgrid;
-        std::istringstream ifs(fileContent);
-        ifs >> textgrid;
+        // Parse straight from the mapped file (or one read buffer if mapping is unavailable).
+        QByteArray fileContent;
+        std::string_view buffer;
+        if (const uchar *mapped = file.map(0, file.size())) {
+            buffer = std::string_view(reinterpret_cast<const char *>(mapped), static_cast<size_t>(file.size()));
+        } else {
+            fileContent = file.readAll();
+            buffer = std::string_view(fileContent.constData(), static_cast<size_t>(fileContent.size()));
+        }
 
-        const auto wordIntervals = textgrid.GetTierAs<textgrid::IntervalTier>("words")->GetAllIntervals();
-        const auto phonesIntervals = textgrid.GetTierAs<textgrid::IntervalTier>("phones")->GetAllIntervals();
+        // Praat may save TextGrids as UTF-16 with a BOM; those are decoded to UTF-8 once before parsing.
+        if (buffer.size() >= 2 && (buffer.substr(0, 2) == "\xFF\xFE" || buffer.substr(0, 2) == "\xFE\xFF")) {
+            const auto utf16 = reinterpret_cast<const char16_t *>(buffer.data());
+            fileContent = QString::fromUtf16(utf16, static_cast<int>(buffer.size() / 2)).toUtf8();
+            buffer = std::string_view(fileContent.constData(), static_cast<size_t>(fileContent.size()));
+        }
 
+        textgrid::TextGrid textgrid;
+        try {
+            textgrid = textgrid::BufferParser(buffer).Parse();
+        } catch (const textgrid::Exception &e) {
+            msg = QString("Failed to parse TextGrid: ") + e.what();
+            return false;
+        }
+        file.close();
 
+        const auto wordTier = textgrid.GetTierAs<textgrid::IntervalTier>("words");
+        const auto phonesTier = textgrid.GetTierAs<textgrid::IntervalTier>("phones");
+        if (!wordTier || !phonesTier) {
+            msg = "TextGrid must contain \"words\" and \"phones\" interval tiers.";
+            return false;
+        }
+        // SOFA writes sorted tiers; anything else is sorted once so the sweeps below stay valid.
+        auto wordIntervals = wordTier->GetAllIntervals();
+        auto phonesIntervals = phonesTier->GetAllIntervals();
+        if (!std::is_sorted(wordIntervals.begin(), wordIntervals.end(), intervalLess))
+            std::stable_sort(wordIntervals.begin(), wordIntervals.end(), intervalLess);
+        if (!std::is_sorted(phonesIntervals.begin(), phonesIntervals.end(), intervalLess))
+            std::stable_sort(phonesIntervals.begin(), phonesIntervals.end(), intervalLess);
+
+        auto apSegments = segment;
+        if (!std::is_sorted(apSegments.begin(), apSegments.end()))
+            std::sort(apSegments.begin(), apSegments.end());
+
+        // Words are keyed by start time: a word starting where the previous one starts replaces it. Keys never
+        // decrease, so only the last word can collide. wordSlot maps every word interval to its word.
+        std::vector<Word> words;
+        std::vector<size_t> wordSlot;
+        words.reserve(wordIntervals.size() * 2);
+        wordSlot.reserve(wordIntervals.size());
+        const auto putWord = [&words](Word word) {
+            if (!words.empty() && words.back().start == word.start)
+                words.back() = std::move(word);
+            else
+                words.push_back(std::move(word));
+            return words.size() - 1;
+        };
 
-        QMap<double, Word> wordsDict;
         double wordCursor = 0;
         for (const auto &interval : wordIntervals) {
             if (interval.min_time > wordCursor)
-                wordsDict[wordCursor] = Word{wordCursor, interval.min_time, "", {}};
-            wordsDict[interval.min_time] = Word{interval.min_time, interval.max_time, interval.text, {}};
+                putWord(Word{wordCursor, interval.min_time, "", {}});
+            wordSlot.push_back(putWord(Word{interval.min_time, interval.max_time, interval.text, {}}));
             wordCursor = interval.max_time;
         }
 
-        for (const auto &interval : wordIntervals) {
-            const double wordStart = interval.min_time;
-            const double wordEnd = interval.max_time;
-
-            for (const auto &phone : phonesIntervals) {
-                if (phone.min_time >= wordStart && phone.max_time <= wordEnd)
-                    wordsDict[interval.min_time].phones.append(Phone{phone.min_time, phone.max_time, phone.text});
+        // Phones contained in a word all start inside it, so each word only scans the phones starting within
+        // its bounds; phoneCursor never moves backwards.
+        size_t phoneCursor = 0;
+        for (size_t w = 0; w < wordIntervals.size(); ++w) {
+            const double wordStart = wordIntervals[w].min_time;
+            const double wordEnd = wordIntervals[w].max_time;
+
+            while (phoneCursor < phonesIntervals.size() && phonesIntervals[phoneCursor].min_time < wordStart)
+                phoneCursor++;
+
+            auto &phones = words[wordSlot[w]].phones;
+            for (size_t p = phoneCursor; p < phonesIntervals.size() && phonesIntervals[p].min_time <= wordEnd; ++p) {
+                const auto &phone = phonesIntervals[p];
+                if (phone.max_time <= wordEnd)
+                    phones.push_back(Phone{phone.min_time, phone.max_time, phone.text});
             }
         }
 
-        QList<Word> out;
-        for (const auto &v : wordsDict) {
+        std::vector<Word> out;
+        out.reserve(words.size() + 2 * apSegments.size());
+        size_t apCursor = 0;
+        for (const auto &v : words) {
             if (v.text == "SP" || v.text.empty()) {
-                const auto sp = v;
+                const auto &sp = v;
                 double cursor;
-                const auto overlappingSegments = find_overlapping_segments(sp.start, sp.end, segment, sp_dur);
+                const auto overlappingSegments =
+                    find_overlapping_segments(sp.start, sp.end, apSegments, apCursor, sp_dur);
                 if (overlappingSegments.empty())
-                    out.append(v);
+                    out.push_back(v);
                 else if (overlappingSegments.size() == 1) {
                     const auto ap = overlappingSegments[0];
                     cursor = sp.start;
                     if (sp.start + sp_dur <= ap.first && ap.first < sp.end) {
-                        out.append(Word{cursor, ap.first, "SP"});
+                        out.push_back(Word{cursor, ap.first, "SP"});
                         cursor = ap.first;
                     }
 
                     if (ap.second <= sp.end - sp_dur) {
-                        out.append(Word{cursor, ap.second, "AP"});
-                        out.append(Word{ap.second, sp.end, "SP"});
+                        out.push_back(Word{cursor, ap.second, "AP"});
+                        out.push_back(Word{ap.second, sp.end, "SP"});
                     } else {
-                        out.append(Word{cursor, sp.end, "AP"});
+                        out.push_back(Word{cursor, sp.end, "AP"});
                     }
                 } else {
                     cursor = sp.start;
-                    for (int i = 0; i < overlappingSegments.size(); i++) {
+                    for (size_t i = 0; i < overlappingSegments.size(); i++) {
                         const auto ap = overlappingSegments[i];
                         if (ap.first > cursor) {
-                            out.append(Word{cursor, ap.first, "SP"});
+                            out.push_back(Word{cursor, ap.first, "SP"});
                             cursor = ap.first;
                         }
 
                         if (i == 0) {
                             if (cursor < ap.first && sp.start + sp_dur <= ap.first && ap.first < sp.end) {
-                                out.append(Word{cursor, ap.first, "SP"});
+                                out.push_back(Word{cursor, ap.first, "SP"});
                                 cursor = ap.first;
                             }
-                            out.append(Word{cursor, ap.second, "AP"});
+                            out.push_back(Word{cursor, ap.second, "AP"});
                             cursor = ap.second;
                         } else if (overlappingSegments.size() - 1) {
                             if (ap.second <= sp.end - sp_dur) {
-                                out.append(Word{cursor, ap.second, "AP"});
-                                out.append(Word{ap.second, sp.end, "SP"});
+                                out.push_back(Word{cursor, ap.second, "AP"});
+                                out.push_back(Word{ap.second, sp.end, "SP"});
                             } else {
-                                out.append(Word{cursor, sp.end, "AP"});
+                                out.push_back(Word{cursor, sp.end, "AP"});
                             }
                         } else {
-                            out.append(Word{cursor, ap.second, "AP"});
+                            out.push_back(Word{cursor, ap.second, "AP"});
                             cursor = ap.second;
                         }
                     }
                 }
             } else {
-                out.append(v);
+                out.push_back(v);
             }
         }
 
         textgrid::TextGrid outTg(0.0, wordCursor);
 
-        auto tierWords = std::make_shared<textgrid::IntervalTier>("words", 0.0, wordCursor);
-        auto tierPhones = std::make_shared<textgrid::IntervalTier>("phones", 0.0, wordCursor);
+        auto tierWords = std::make_shared<textgrid::IntervalTier>("words", 0.0, wordCursor, out.size());
+        auto tierPhones = std::make_shared<textgrid::IntervalTier>("phones", 0.0, wordCursor, phonesIntervals.size());
 
         for (const auto &item : out) {
             tierWords->AppendInterval(textgrid::Interval(item.start, item.end, item.text));
@@ -197,18 +360,21 @@ namespace FBL {
         outTg.AppendTier(tierWords);
         outTg.AppendTier(tierPhones);
 
-        QFile outFile(m_outTgPath);
-        if (outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-            QTextStream outTgStream(&outFile);
-            std::ostringstream oss;
-            oss << outTg;
-            outTgStream << QString::fromStdString(oss.str());
-        } else {
-            fblMsg = "Failed to open file for writing.";
+        QFile outFile(task.outTgPath);
+        if (!outFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            msg = "Failed to open file for writing.";
+            return false;
         }
 
-        fblMsg = "success.";
+        m_writeBuffer.clear();
+        outTg.Accept(textgrid::BufferWriter(m_writeBuffer));
+        if (outFile.write(m_writeBuffer.data(), static_cast<qint64>(m_writeBuffer.size())) !=
+            static_cast<qint64>(m_writeBuffer.size())) {
+            msg = "Failed to write file: " + outFile.errorString();
+            return false;
+        }
 
-        Q_EMIT this->oneFinished(m_filename, fblMsg);
+        msg = "success.";
+        return true;
     }
 }
\ No newline at end of file
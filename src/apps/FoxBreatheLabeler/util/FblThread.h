@@ -6,28 +6,46 @@
 
 #include <QSharedPointer>
 
-#include "Fbl.h"
+#include "ApCache.h"
+#include "FblPool.h"
 
 namespace FBL {
+    struct FblTask {
+        QString filename;
+        QString wavPath;
+        QString rawTgPath;
+        QString outTgPath;
+        double duration = 0; // seconds, filled in by makeBatches
+    };
+
     class FblThread final : public QObject, public QRunnable {
         Q_OBJECT
     public:
-        FblThread(FBL *fbl, QString filename, QString wavPath, QString rawTgPath, QString outTgPath,
-                  float ap_threshold = 0.4, float ap_dur = 0.08, float sp_dur = 0.1);
+        // With a cache, files whose ap_probability is cached skip decoding and inference, and new curves are stored.
+        FblThread(FblPool *pool, QList<FblTask> tasks, float ap_threshold = 0.4, float ap_dur = 0.08,
+                  float sp_dur = 0.1, const ApCache *cache = nullptr);
         void run() override;
 
+        // Sorts tasks by audio duration and cuts them into batches of similar length, so the zero padding of each
+        // [batch, max_len] model input stays small. A batch never exceeds maxBatchSize files or maxBatchSeconds of
+        // padded audio.
+        static QList<QList<FblTask>> makeBatches(QList<FblTask> tasks, int maxBatchSize = 8,
+                                                 double maxBatchSeconds = 240);
+
     private:
-        FBL *m_asr;
-        QString m_filename;
-        QString m_wavPath;
-        QString m_rawTgPath;
-        QString m_outTgPath;
+        bool writeTextGrid(const FblTask &task, const std::vector<std::pair<float, float>> &segment, QString &msg);
+
+        FblPool *m_pool;
+        const ApCache *m_cache;
+        QList<FblTask> m_tasks;
+        std::string m_writeBuffer; // reused for every TextGrid of the batch
 
         float ap_threshold, ap_dur, sp_dur;
 
     signals:
-        void oneFailed(const QString &filename, const QString &msg);
-        void oneFinished(const QString &filename, const QString &msg);
+        // elapsedMs is the time spent on this file: its decoding and TextGrid IO plus the shared batch inference.
+        void oneFailed(const QString &filename, const QString &msg, qint64 elapsedMs);
+        void oneFinished(const QString &filename, const QString &msg, qint64 elapsedMs);
     };
 }
 
@@ -23,10 +23,16 @@
 #ifndef TEXTGRID_HPP_
 #define TEXTGRID_HPP_
 
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -679,6 +685,320 @@ class Parser {
   std::unique_ptr<Lexer> lexer_;
 };
 
+// Token whose value points into the buffer being parsed. Values are kept escaped, so no
+// per-token allocation happens while lexing.
+struct TokenView {
+  explicit TokenView(TokenType type, std::string_view value = {}) : type(type), value(value) {}
+
+  TokenType type;
+  std::string_view value;
+};
+
+inline std::string UnescapeText(std::string_view str) {
+  std::string unescaped_str;
+  unescaped_str.reserve(str.size());
+  for (size_t i = 1; i + 1 < str.size(); ++i) {
+    if (str[i] == '"' && str[i + 1] == '"') {
+      unescaped_str += str[i++];
+    } else {
+      unescaped_str += str[i];
+    }
+  }
+  return unescaped_str;
+}
+
+inline std::string_view UnescapeFlag(std::string_view str) {
+  if (str.size() < 2) {
+    return {};
+  } else {
+    return str.substr(1u, str.size() - 2);
+  }
+}
+
+// Same grammar and errors as StreamLexer, but works on an in-memory (e.g. memory-mapped)
+// buffer that must outlive the lexer.
+class BufferLexer {
+ public:
+  explicit BufferLexer(std::string_view buffer) : buffer_(buffer), pos_(0), lineno_(1) {
+    // Skip the UTF-8 byte order mark.
+    if (buffer_.substr(0, 3) == "\xEF\xBB\xBF") {
+      pos_ = 3;
+    }
+  }
+
+  TokenView GetNextToken() {
+    SkipSpaces();
+    if (IsEof()) {
+      return TokenView(TokenType::END_OF_FILE);
+    }
+    switch (Peek()) {
+      case '0':
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case '7':
+      case '8':
+      case '9':
+        return GetNumberToken();
+      case '\"':
+        return GetTextToken();
+      case '<':
+        return GetFlagToken();
+      case '!':
+        return GetLineCommentToken();
+      default:
+        return GetCommentToken();
+    }
+  }
+  TokenView GetNextTokenExceptComment() {
+    TokenView token = GetNextToken();
+    while (token.type == TokenType::COMMENT) {
+      token = GetNextToken();
+    }
+    return token;
+  }
+  int GetLineNumber() const noexcept { return lineno_; }
+
+ private:
+  static bool IsSpace(char c) { return isspace(static_cast<unsigned char>(c)); }
+  static bool IsDigit(char c) { return isdigit(static_cast<unsigned char>(c)); }
+  static bool IsNewlineChar(char c) { return c == '\r' || c == '\n'; }
+
+  bool IsEof() const noexcept { return pos_ >= buffer_.size(); }
+  char Peek() const noexcept { return buffer_[pos_]; }
+  void Advance() {
+    if (buffer_[pos_++] == '\n') {
+      lineno_++;
+    }
+  }
+  void SkipSpaces() {
+    while (!IsEof() && IsSpace(Peek())) {
+      Advance();
+    }
+  }
+  std::string_view Slice(size_t begin) const { return buffer_.substr(begin, pos_ - begin); }
+  void CheckFreeStanding(const char* what, size_t begin) const {
+    if (!IsEof() && !IsSpace(Peek())) {
+      const std::string message = "Character '" + std::string(1u, Peek()) + "' following " + what +
+                                  " " + std::string(Slice(begin));
+      throw LexicalError(message, lineno_);
+    }
+  }
+
+  TokenView GetNumberToken() {
+    const size_t begin = pos_;
+    while (!IsEof() && IsDigit(Peek())) {
+      Advance();
+    }
+    if (!IsEof() && Peek() == '.') {
+      Advance();
+    }
+    while (!IsEof() && IsDigit(Peek())) {
+      Advance();
+    }
+    CheckFreeStanding("number", begin);
+    return TokenView(TokenType::NUMBER_LITERAL, Slice(begin));
+  }
+  TokenView GetTextToken() {
+    // Note: Currently, the text token in multiple lines is not supported.
+    const size_t begin = pos_;
+    Advance();  // '\"'
+    bool closed = false;
+    while (!IsEof() && !IsNewlineChar(Peek())) {
+      if (Peek() == '\"') {
+        Advance();
+        if (!IsEof() && Peek() == '\"') {
+          Advance();
+        } else {
+          closed = true;
+          break;
+        }
+      } else {
+        Advance();
+      }
+    }
+    if (!closed && Slice(begin).back() != '\"') {
+      throw LexicalError("Early end of text is detected while reading a string", lineno_);
+    }
+    CheckFreeStanding("text", begin);
+    return TokenView(TokenType::TEXT_LITERAL, Slice(begin));
+  }
+  TokenView GetFlagToken() {
+    const size_t begin = pos_;
+    Advance();  // '<'
+    while (!IsEof() && !IsNewlineChar(Peek())) {
+      if (Peek() == '>') {
+        Advance();
+        break;
+      } else {
+        Advance();
+      }
+    }
+    if (Slice(begin).back() != '>') {
+      throw LexicalError("No matching '>' while reading a flag", lineno_);
+    }
+    CheckFreeStanding("flag", begin);
+    return TokenView(TokenType::FLAG_LITERAL, Slice(begin));
+  }
+  TokenView GetLineCommentToken() {
+    const size_t begin = pos_;
+    while (!IsEof() && !IsNewlineChar(Peek())) {
+      Advance();
+    }
+    return TokenView(TokenType::COMMENT, Slice(begin));
+  }
+  TokenView GetCommentToken() {
+    const size_t begin = pos_;
+    while (!IsEof() && !IsSpace(Peek())) {
+      Advance();
+    }
+    return TokenView(TokenType::COMMENT, Slice(begin));
+  }
+
+ private:
+  std::string_view buffer_;
+  size_t pos_;
+  int lineno_;
+};
+
+// Builds the same TextGrid as Parser, directly from a buffer: the file is never copied into a
+// stream and only the final interval/point texts are allocated.
+class BufferParser {
+ private:
+  static bool Expect(const TokenView& token, TokenType type) { return token.type == type; }
+
+ public:
+  explicit BufferParser(std::string_view buffer) : lexer_(buffer) {}
+
+  TextGrid Parse() {
+    ParseHeader();
+    return ParseTextGrid();
+  }
+
+ private:
+  void ParseHeaderFileType() {
+    static const std::string kFileType = "ooTextFile";
+    const std::string text = ParseText();
+    if (text != kFileType) {
+      throw SyntaxError("Invalid TextGrid Header. File type must be \"" + kFileType +
+                            "\", but it's \"" + text + "\"",
+                        lexer_.GetLineNumber());
+    }
+  }
+  void ParseHeaderObjectClass() {
+    static const std::string kObjectClass = "TextGrid";
+    const std::string text = ParseText();
+    if (text != kObjectClass) {
+      throw SyntaxError("Invalid TextGrid Header. Object class must be \"" + kObjectClass +
+                            "\", but it's \"" + text + "\"",
+                        lexer_.GetLineNumber());
+    }
+  }
+  void ParseHeader() {
+    ParseHeaderFileType();
+    ParseHeaderObjectClass();
+  }
+
+  Number ParseNumber() {
+    const TokenView token = lexer_.GetNextTokenExceptComment();
+    if (!Expect(token, TokenType::NUMBER_LITERAL)) {
+      throw SyntaxError("Found a " + ToString(token.type) + " while looking for a real number",
+                        lexer_.GetLineNumber());
+    }
+    // The view is not null terminated; numbers are short, so a stack copy is enough.
+    char buf[64];
+    const size_t len = std::min(token.value.size(), sizeof(buf) - 1);
+    token.value.copy(buf, len);
+    buf[len] = '\0';
+    return strtod(buf, nullptr);
+  }
+  std::string ParseText() {
+    const TokenView token = lexer_.GetNextTokenExceptComment();
+    if (!Expect(token, TokenType::TEXT_LITERAL)) {
+      throw SyntaxError("Found a " + ToString(token.type) + " while looking for a text",
+                        lexer_.GetLineNumber());
+    }
+    return UnescapeText(token.value);
+  }
+  void ParseExistsFlag() {
+    static const std::string_view kExistsFlag = "exists";
+    const TokenView token = lexer_.GetNextTokenExceptComment();
+    if (!Expect(token, TokenType::FLAG_LITERAL)) {
+      throw SyntaxError("Found a " + ToString(token.type) + " while looking for a flag",
+                        lexer_.GetLineNumber());
+    }
+    const std::string_view flag = UnescapeFlag(token.value);
+    if (flag != kExistsFlag) {
+      throw SyntaxError("<" + std::string(flag) + "> is not valid flag for TextGrid file",
+                        lexer_.GetLineNumber());
+    }
+  }
+
+  std::shared_ptr<Tier> ParseIntervalTier() {
+    const std::string name = ParseText();
+    const Number min_time = ParseNumber();
+    const Number max_time = ParseNumber();
+    const size_t number_of_intervals = ParseNumber();
+    std::shared_ptr<IntervalTier> interval_tier =
+        std::make_shared<IntervalTier>(name, min_time, max_time, number_of_intervals);
+    for (size_t i = 0; i < number_of_intervals; ++i) {
+      Interval interval;
+      interval.min_time = ParseNumber();
+      interval.max_time = ParseNumber();
+      interval.text = ParseText();
+      interval_tier->AppendInterval(std::move(interval));
+    }
+    return interval_tier;
+  }
+  std::shared_ptr<Tier> ParsePointTier() {
+    const std::string name = ParseText();
+    const Number min_time = ParseNumber();
+    const Number max_time = ParseNumber();
+    const size_t number_of_points = ParseNumber();
+    std::shared_ptr<PointTier> point_tier =
+        std::make_shared<PointTier>(name, min_time, max_time, number_of_points);
+    for (size_t i = 0; i < number_of_points; ++i) {
+      Point point;
+      point.time = ParseNumber();
+      point.text = ParseText();
+      point_tier->AppendPoint(std::move(point));
+    }
+    return point_tier;
+  }
+  std::shared_ptr<Tier> ParseTier() {
+    static const std::string kIntervalTierClass = "IntervalTier";
+    static const std::string kTextTierClass = "TextTier";
+    const std::string klass = ParseText();
+    if (klass == kIntervalTierClass) {
+      return ParseIntervalTier();
+    } else if (klass == kTextTierClass) {
+      // Note: PointTier is also called TextTier. They are the same.
+      return ParsePointTier();
+    } else {
+      throw SyntaxError("Class \"" + klass + "\" is not valid class name.",
+                        lexer_.GetLineNumber());
+    }
+  }
+
+  TextGrid ParseTextGrid() {
+    const Number min_time = ParseNumber();
+    const Number max_time = ParseNumber();
+    ParseExistsFlag();
+    const size_t number_of_tiers = ParseNumber();
+    TextGrid grid(min_time, max_time, number_of_tiers);
+    for (size_t i = 0; i < number_of_tiers; ++i) {
+      grid.AppendTier(ParseTier());
+    }
+    return grid;
+  }
+
+ private:
+  BufferLexer lexer_;
+};
+
 class TextGridInternalVisitor : public TextGridVisitor {
  public:
   enum class TraversalOrder {
@@ -916,6 +1236,129 @@ class Writer : public TextGridInternalVisitor {
   size_t point_index_;
 };
 
+// Produces byte-identical output to Writer, but appends straight into a caller-owned byte
+// buffer (which can be reused between files) instead of going through std::ostream. Numbers are
+// formatted with std::to_chars, which is locale independent like the "C" locale of a default
+// constructed stream.
+class BufferWriter : public TextGridInternalVisitor {
+ public:
+  explicit BufferWriter(std::string& buffer)
+      : TextGridInternalVisitor(TraversalOrder::PreOrder),
+        buffer_(buffer),
+        tier_index_(0u),
+        interval_index_(0u),
+        point_index_(0u) {}
+  ~BufferWriter() noexcept override = default;
+
+  void VisitInternally(const TextGrid& text_grid) override {
+    WriteAttribute("", "File type", "ooTextFile");
+    WriteAttribute("", "Object class", "TextGrid");
+    buffer_ += '\n';
+    WriteAttribute("", "xmin", text_grid.GetMinTime());
+    WriteAttribute("", "xmax", text_grid.GetMaxTime());
+    buffer_ += "tiers? <exists>\n";
+    WriteAttribute("", "size", static_cast<Number>(text_grid.GetNumberOfTiers()));
+    buffer_ += "item []:\n";
+  }
+
+  void VisitInternally(const IntervalTier& interval_tier) override {
+    WriteHeader("    item [", tier_index_);
+    WriteAttribute(kTierIndent, "class", "IntervalTier");
+    WriteAttribute(kTierIndent, "name", interval_tier.GetName());
+    WriteAttribute(kTierIndent, "xmin", interval_tier.GetMinTime());
+    WriteAttribute(kTierIndent, "xmax", interval_tier.GetMaxTime());
+    WriteAttribute(kTierIndent, "intervals: size",
+                   static_cast<Number>(interval_tier.GetNumberOfIntervals()));
+    tier_index_++;
+    interval_index_ = 0u;
+  }
+  void VisitInternally(const Interval& interval) override {
+    WriteHeader("        intervals [", interval_index_);
+    WriteAttribute(kItemIndent, "xmin", interval.min_time);
+    WriteAttribute(kItemIndent, "xmax", interval.max_time);
+    WriteAttribute(kItemIndent, "text", interval.text);
+    interval_index_++;
+  }
+
+  void VisitInternally(const PointTier& point_tier) override {
+    WriteHeader("    item [", tier_index_);
+    WriteAttribute(kTierIndent, "class", "TextTier");
+    WriteAttribute(kTierIndent, "name", point_tier.GetName());
+    WriteAttribute(kTierIndent, "xmin", point_tier.GetMinTime());
+    WriteAttribute(kTierIndent, "xmax", point_tier.GetMaxTime());
+    WriteAttribute(kTierIndent, "points: size",
+                   static_cast<Number>(point_tier.GetNumberOfPoints()));
+    tier_index_++;
+    point_index_ = 0u;
+  }
+  void VisitInternally(const Point& point) override {
+    WriteHeader("        points [", point_index_);
+    WriteAttribute(kItemIndent, "time", point.time);
+    WriteAttribute(kItemIndent, "mark", point.text);
+    point_index_++;
+  }
+
+ private:
+  static constexpr const char* kTierIndent = "        ";
+  static constexpr const char* kItemIndent = "            ";
+
+  void WriteHeader(const char* prefix, size_t index) {
+    char buf[24];
+    const auto result = std::to_chars(buf, buf + sizeof(buf), index + 1);
+    buffer_ += prefix;
+    buffer_.append(buf, result.ptr);
+    buffer_ += "]:\n";
+  }
+  void WriteNumber(Number value) {
+    // Same as "os << value" with the default precision of 6, i.e. printf("%g").
+    char buf[32];
+#if defined(__cpp_lib_to_chars)
+    const auto result = std::to_chars(buf, buf + sizeof(buf), value, std::chars_format::general, 6);
+    buffer_.append(buf, result.ptr);
+#else
+    // Floating point to_chars is missing from older libc++; fall back to printf and undo a
+    // non-"C" decimal point.
+    const int len = snprintf(buf, sizeof(buf), "%g", value);
+    for (int i = 0; i < len; ++i) {
+      buffer_ += (buf[i] == ',') ? '.' : buf[i];
+    }
+#endif
+  }
+  void WriteText(const std::string& value) {
+    buffer_ += '"';
+    for (const char c : value) {
+      if (c == '"') {
+        buffer_ += c;
+      }
+      buffer_ += c;
+    }
+    buffer_ += '"';
+  }
+  void WriteAttribute(const char* indent, const char* name, Number value) {
+    buffer_ += indent;
+    buffer_ += name;
+    buffer_ += " = ";
+    WriteNumber(value);
+    buffer_ += '\n';
+  }
+  void WriteAttribute(const char* indent, const char* name, const std::string& value) {
+    buffer_ += indent;
+    buffer_ += name;
+    buffer_ += " = ";
+    WriteText(value);
+    buffer_ += '\n';
+  }
+  void WriteAttribute(const char* indent, const char* name, const char* value) {
+    WriteAttribute(indent, name, std::string(value));
+  }
+
+ private:
+  std::string& buffer_;
+  size_t tier_index_;
+  size_t interval_index_;
+  size_t point_index_;
+};
+
 inline std::istream& operator>>(std::istream& is, TextGrid& text_grid) {
   text_grid = Parser(is).Parse();
   return is;
@@ -1,5 +1,7 @@
 #include "MainWindow.h"
 
+#include <algorithm>
+
 #include "G2pglobal.h"
 
 #include <QApplication>
@@ -9,6 +11,7 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QStatusBar>
+#include <QThread>
 
 #include "QMSystem.h"
 #include <QStandardPaths>
@@ -55,6 +58,10 @@ namespace LyricFA {
         m_threadpool = new QThreadPool(this);
         m_threadpool->setMaxThreadCount(1);
 
+        // Lyric matching is pure CPU work with a per-thread G2P, so it can use every core.
+        m_matchThreadpool = new QThreadPool(this);
+        m_matchThreadpool->setMaxThreadCount(QThread::idealThreadCount());
+
         initStyleSheet();
         setAcceptDrops(true);
 
@@ -171,7 +178,13 @@ namespace LyricFA {
         resize(960, 720);
     }
 
-    MainWindow::~MainWindow() = default;
+    MainWindow::~MainWindow() {
+        // FaTreads use m_match; its per-thread G2P instances are released as the pool threads exit.
+        m_matchThreadpool->clear();
+        m_matchThreadpool->waitForDone();
+        delete m_matchThreadpool;
+        delete m_match;
+    }
 
     void MainWindow::addFiles(const QStringList &paths) const {
         for (const auto &path : paths) {
@@ -340,9 +353,6 @@ namespace LyricFA {
             return;
         }
 
-        out->clear();
-        m_threadpool->clear();
-
         if (!QDir(jsonFolder).exists())
             qDebug() << QDir(jsonFolder).mkpath(jsonFolder);
 
@@ -354,22 +364,57 @@ namespace LyricFA {
                 labPaths << labDir.absoluteFilePath(file);
         }
 
+        if (labPaths.isEmpty()) {
+            QMessageBox::information(nullptr, "Warning", "No lab file found in Lab Out Path.");
+            return;
+        }
+
+        // Workers report by index into m_matchReport and read the lyric dict, so no run may still be in flight;
+        // the button is enabled again once the last segment has reported.
+        matchLyric->setEnabled(false);
+        out->clear();
         m_match->initLyric(lyricFolder);
 
         m_workError = 0;
         m_workFinished = 0;
         m_workTotal = labPaths.size();
+        m_matchReport = QStringList();
+        m_matchReport.reserve(labPaths.size());
+        for (int i = 0; i < labPaths.size(); i++)
+            m_matchReport.append(QString());
         progressBar->setValue(0);
         progressBar->setMaximum(labPaths.size());
 
-        for (const auto &labPath : labPaths) {
-            const auto lab_name = QFileInfo(labPath).completeBaseName();
-            const auto jsonPath = jsonFolder + QDir::separator() + lab_name + ".json";
+        // Group the segments of each song by lyric name ("<lyric>_NNN") so they are aligned in one pass.
+        QMap<QString, QList<int>> songs;
+        for (int i = 0; i < labPaths.size(); i++) {
+            const auto lab_name = QFileInfo(labPaths[i]).completeBaseName();
+            songs[lab_name.left(lab_name.lastIndexOf('_'))].append(i);
+        }
+
+        const auto segmentNumber = [&labPaths](const int &index) {
+            const auto lab_name = QFileInfo(labPaths[index]).completeBaseName();
+            return lab_name.mid(lab_name.lastIndexOf('_') + 1).toInt();
+        };
+
+        for (auto it = songs.begin(); it != songs.end(); ++it) {
+            auto &indexes = it.value();
+            std::stable_sort(indexes.begin(), indexes.end(), [&segmentNumber](const int &a, const int &b) {
+                return segmentNumber(a) < segmentNumber(b);
+            });
+
+            QList<MatchLyric::LabInfo> segments;
+            for (const auto &index : indexes) {
+                const auto &labPath = labPaths[index];
+                const auto lab_name = QFileInfo(labPath).completeBaseName();
+                const auto jsonPath = jsonFolder + QDir::separator() + lab_name + ".json";
+                segments.append({lab_name, labPath, jsonPath});
+            }
 
-            const auto faTread = new FaTread(m_match, lab_name, labPath, jsonPath);
-            connect(faTread, &FaTread::oneFailed, this, &MainWindow::slot_oneFailed);
-            connect(faTread, &FaTread::oneFinished, this, &MainWindow::slot_oneFinished);
-            m_threadpool->start(faTread);
+            const auto faTread = new FaTread(m_match, indexes, segments);
+            connect(faTread, &FaTread::oneFailed, this, &MainWindow::slot_matchFailed);
+            connect(faTread, &FaTread::oneFinished, this, &MainWindow::slot_matchFinished);
+            m_matchThreadpool->start(faTread);
         }
     }
 
@@ -425,7 +470,39 @@ namespace LyricFA {
         }
     }
 
+    void MainWindow::slot_matchFailed(const int index, const QString &filename, const QString &msg) {
+        m_workFinished++;
+        m_workError++;
+        m_failIndex.append(filename + ": " + msg);
+        m_matchReport[index] = filename + ": " + msg;
+        progressBar->setValue(m_workFinished);
+
+        if (m_workFinished == m_workTotal) {
+            slot_threadFinished();
+            matchLyric->setEnabled(true);
+        }
+    }
+
+    void MainWindow::slot_matchFinished(const int index, const QString &filename, const QString &msg) {
+        m_workFinished++;
+        if (!msg.isEmpty())
+            m_matchReport[index] = filename + ": " + msg;
+        progressBar->setValue(m_workFinished);
+
+        if (m_workFinished == m_workTotal) {
+            slot_threadFinished();
+            matchLyric->setEnabled(true);
+        }
+    }
+
     void MainWindow::slot_threadFinished() {
+        // Workers finish out of order; the match report is printed in lab order once everything is done.
+        for (const QString &report : m_matchReport) {
+            if (!report.isEmpty())
+                out->appendPlainText(report);
+        }
+        m_matchReport.clear();
+
         const auto msg = QString("Asr complete! Total: %3, Success: %1, Failed: %2")
                              .arg(m_workTotal - m_workError)
                              .arg(m_workError)
@@ -76,7 +76,9 @@ namespace LyricFA {
         int m_workFinished = 0;
         int m_workError = 0;
         QStringList m_failIndex;
+        QStringList m_matchReport;
         QThreadPool *m_threadpool;
+        QThreadPool *m_matchThreadpool;
 
         static void initStyleSheet();
 
@@ -91,6 +93,8 @@ namespace LyricFA {
 
         void slot_oneFailed(const QString &filename, const QString &msg);
         void slot_oneFinished(const QString &filename, const QString &msg);
+        void slot_matchFailed(int index, const QString &filename, const QString &msg);
+        void slot_matchFinished(int index, const QString &filename, const QString &msg);
         void slot_threadFinished();
 
         void _q_fileMenuTriggered(const QAction *action);
@@ -4,20 +4,20 @@
 #include <QMSystem.h>
 
 namespace LyricFA {
-    FaTread::FaTread(MatchLyric *match, QString filename, QString labPath, QString jsonPath, const bool &asr_rectify)
-        : m_match(match), m_filename(std::move(filename)), m_labPath(std::move(labPath)),
-          m_jsonPath(std::move(jsonPath)), m_asr_rectify(asr_rectify) {
+    FaTread::FaTread(MatchLyric *match, QList<int> indexes, QList<MatchLyric::LabInfo> segments,
+                     const bool &asr_rectify)
+        : m_match(match), m_indexes(std::move(indexes)), m_segments(std::move(segments)), m_asr_rectify(asr_rectify) {
     }
 
     void FaTread::run() {
-        QString matchMsg;
-        const auto matchRes = m_match->match(m_filename, m_labPath, m_jsonPath, matchMsg, m_asr_rectify);
+        const auto results = m_match->matchSong(m_segments, m_asr_rectify);
 
-        if (!matchRes) {
-            Q_EMIT this->oneFailed(m_filename, matchMsg);
-            return;
+        for (int i = 0; i < results.size(); i++) {
+            if (!results[i].success)
+                Q_EMIT this->oneFailed(m_indexes[i], m_segments[i].filename, results[i].msg);
+            else
+                Q_EMIT this->oneFinished(m_indexes[i], m_segments[i].filename, results[i].msg);
         }
-        Q_EMIT this->oneFinished(m_filename, matchMsg);
     }
 
 } // LyricFA
\ No newline at end of file
@@ -11,19 +11,20 @@ namespace LyricFA {
     class FaTread final : public QObject, public QRunnable {
         Q_OBJECT
     public:
-        FaTread(MatchLyric *match, QString filename, QString labPath, QString jsonPath, const bool &asr_rectify = true);
+        // One task per song: all segments of a lyric are aligned together, indexes identify them in the report.
+        FaTread(MatchLyric *match, QList<int> indexes, QList<MatchLyric::LabInfo> segments,
+                const bool &asr_rectify = true);
         void run() override;
 
     private:
         MatchLyric *m_match;
-        QString m_filename;
-        QString m_labPath;
-        QString m_jsonPath;
+        QList<int> m_indexes;
+        QList<MatchLyric::LabInfo> m_segments;
         bool m_asr_rectify;
 
     signals:
-        void oneFailed(const QString &filename, const QString &msg);
-        void oneFinished(const QString &filename, const QString &msg);
+        void oneFailed(int index, const QString &filename, const QString &msg);
+        void oneFinished(int index, const QString &filename, const QString &msg);
     };
 
 } // LyricFA
@@ -37,6 +37,112 @@ namespace LyricFA {
                 fill_step_out(calcuRes.corresponding_characters, del_tip, ins_tip, sub_tip)};
     }
 
+    QList<FaRes> LevenshteinDistance::align_segments(const QList<QStringList> &targets, const QStringList &pinyin_list,
+                                                     QStringList text_list, const bool &del_tip, const bool &ins_tip,
+                                                     const bool &sub_tip, const int &del_cost, const int &ins_cost,
+                                                     const int &sub_cost) {
+        if (text_list.isEmpty())
+            text_list = pinyin_list;
+        Q_ASSERT(text_list.size() == pinyin_list.size());
+        Q_ASSERT(sub_cost < del_cost + ins_cost);
+
+        enum Step : uchar { Diag, Ins, Del, Skip };
+
+        // Concatenate all segments; row j of the DP is "first j target tokens consumed".
+        QStringList target;
+        QVector<int> segOf;   // segment owning target token j - 1, i.e. row j
+        QVector<bool> border; // row j sits between two segments (or before the first / after the last)
+        border.append(true);
+        segOf.append(0);
+        for (int k = 0; k < targets.size(); k++) {
+            for (const auto &token : targets[k]) {
+                target.append(token);
+                segOf.append(k);
+                border.append(false);
+            }
+            border.last() = true;
+        }
+
+        const int m = target.size();
+        const int n = pinyin_list.size();
+        const int cols = n + 1;
+
+        QVector<int> prev(cols, 0);
+        QVector<int> cur(cols, 0);
+        QVector<uchar> trace((m + 1) * cols, Skip);
+
+        for (int j = 1; j <= m; j++) {
+            cur[0] = prev[0] + ins_cost;
+            trace[j * cols] = Ins;
+            for (int i = 1; i <= n; i++) {
+                int best = prev[i - 1] + (pinyin_list[i - 1] == target[j - 1] ? 0 : sub_cost);
+                uchar step = Diag;
+                if (prev[i] + ins_cost < best) {
+                    best = prev[i] + ins_cost;
+                    step = Ins;
+                }
+                if (border[j]) {
+                    if (cur[i - 1] < best) {
+                        best = cur[i - 1];
+                        step = Skip;
+                    }
+                } else if (cur[i - 1] + del_cost < best) {
+                    best = cur[i - 1] + del_cost;
+                    step = Del;
+                }
+                cur[i] = best;
+                trace[j * cols + i] = step;
+            }
+            std::swap(prev, cur);
+        }
+
+        // Free trailing lyric: the last row is a border, so prev[n] already holds the best end position.
+        QVector<QList<StepPair>> texts(targets.size());
+        QVector<QList<StepPair>> chars(targets.size());
+        int j = m;
+        int i = n;
+        while (j > 0) {
+            const uchar step = i > 0 ? trace[j * cols + i] : Ins;
+            const int k = segOf[j];
+            if (step == Diag) {
+                chars[k].prepend({pinyin_list[i - 1], target[j - 1]});
+                texts[k].prepend({text_list[i - 1], pinyin_list[i - 1] == target[j - 1] ? text_list[i - 1]
+                                                                                        : target[j - 1]});
+                i--;
+                j--;
+            } else if (step == Ins) {
+                chars[k].prepend({QString(), target[j - 1]});
+                texts[k].prepend({QString(), target[j - 1]});
+                j--;
+            } else if (step == Del) {
+                chars[k].prepend({pinyin_list[i - 1], QString()});
+                texts[k].prepend({text_list[i - 1], QString()});
+                i--;
+            } else {
+                i--;
+            }
+        }
+
+        QList<FaRes> results;
+        for (int k = 0; k < targets.size(); k++) {
+            FaRes res;
+            for (int s = 0; s < chars[k].size(); s++) {
+                const auto &x = chars[k][s];
+                const auto &y = texts[k][s];
+                if (x.raw == x.res || (!x.raw.isEmpty() && !x.res.isEmpty())) {
+                    res.match_pinyin.append(x.raw);
+                    res.match_text.append(y.raw);
+                } else if (x.raw.isEmpty() && !x.res.isEmpty()) {
+                    res.match_pinyin.append(x.res);
+                    res.match_text.append(y.res);
+                }
+            }
+            res.text_step = fill_step_out(texts[k], del_tip, ins_tip, sub_tip);
+            res.pinyin_step = fill_step_out(chars[k], del_tip, ins_tip, sub_tip);
+            results.append(res);
+        }
+        return results;
+    }
 
     MacthRes LevenshteinDistance::find_best_matches(const QStringList &text_list, const QStringList &source_list,
                                                     const QStringList &sub_list) {
@@ -38,6 +38,15 @@ namespace LyricFA {
                                              QStringList text_list = {}, const bool &del_tip = false,
                                              const bool &ins_tip = false, const bool &sub_tip = false);
 
+        // Song-level alignment: all segments are matched against the lyric in one DP pass. Segment spans are
+        // monotonic and never overlap; lyric tokens between two segments are skipped at no cost.
+        // sub_cost must stay below del_cost + ins_cost, otherwise a misheard syllable is inserted from the ASR
+        // result instead of being substituted by the lyric text.
+        static QList<FaRes> align_segments(const QList<QStringList> &targets, const QStringList &pinyin_list,
+                                           QStringList text_list = {}, const bool &del_tip = false,
+                                           const bool &ins_tip = false, const bool &sub_tip = false,
+                                           const int &del_cost = 1, const int &ins_cost = 1, const int &sub_cost = 1);
+
     private:
         static MacthRes find_best_matches(const QStringList &text_list, const QStringList &source_list,
                                           const QStringList &sub_list);
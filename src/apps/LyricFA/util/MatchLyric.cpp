@@ -6,7 +6,6 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QMap>
-#include <QMessageBox>
 
 #include "../util/LevenshteinDistance.h"
 
@@ -17,10 +16,20 @@ namespace LyricFA {
 #else
         IKg2p::setDictionaryPath(QApplication::applicationDirPath() + "/dict");
 #endif
-        m_mandarin = std::make_unique<IKg2p::MandarinG2p>();
     }
 
-    MatchLyric::~MatchLyric() = default;
+    MatchLyric::~MatchLyric() {
+        // QThreadStorage leaks whatever is left when it is destroyed: the pool threads must have exited by now,
+        // only the instance created by initLyric() on this thread remains.
+        if (m_mandarin.hasLocalData())
+            m_mandarin.setLocalData(nullptr);
+    }
+
+    IKg2p::MandarinG2p *MatchLyric::mandarin() const {
+        if (!m_mandarin.hasLocalData())
+            m_mandarin.setLocalData(new IKg2p::MandarinG2p());
+        return m_mandarin.localData();
+    }
 
     static QString get_lyrics_from_txt(const QString &lyricPath) {
         QFile lyricFile(lyricPath);
@@ -58,89 +67,117 @@ namespace LyricFA {
                 lyricPaths << lyricDir.absoluteFilePath(file);
         }
 
+        const auto g2p = mandarin();
         for (const auto &lyricPath : lyricPaths) {
             const auto lyricName = QFileInfo(lyricPath).completeBaseName();
             const auto textList = IKg2p::splitString(get_lyrics_from_txt(lyricPath));
-            const auto g2pRes = m_mandarin->hanziToPinyin(textList.join(' '), false, false);
-            const auto pinyin = m_mandarin->resToStringList(g2pRes);
+            const auto g2pRes = g2p->hanziToPinyin(textList.join(' '), false, false);
+            const auto pinyin = g2p->resToStringList(g2pRes);
             m_lyricDict[lyricName] = lyricInfo{textList, pinyin};
         }
     }
 
-    bool MatchLyric::match(const QString &filename, const QString &labPath, const QString &jsonPath, QString &msg,
-                           const bool &asr_rectify) const {
-        const auto lyricName = filename.left(filename.lastIndexOf('_'));
+    bool MatchLyric::writeResult(const QString &filename, const QString &jsonPath, const QStringList &asrPinyins,
+                                 FaRes faRes, QString &msg, const bool &asr_rectify) const {
+        const auto g2p = mandarin();
+
+        QStringList asr_rect_list;
+        QStringList asr_rect_diff;
+
+        for (int i = 0; i < asrPinyins.size(); i++) {
+            const auto &asrPinyin = asrPinyins[i];
+            const auto text = faRes.match_text[i];
+            const auto matchPinyin = faRes.match_pinyin[i];
+
+            if (asrPinyin != matchPinyin) {
+                const QStringList candidate = g2p->getDefaultPinyin(text);
+                if (candidate.contains(asrPinyin)) {
+                    asr_rect_list.append(asrPinyin);
+                    asr_rect_diff.append("(" + matchPinyin + "->" + asrPinyin + ", " +
+                                         QString::number(asrPinyins.indexOf(asrPinyin)) + ")");
+                } else
+                    asr_rect_list.append(matchPinyin);
+            } else if (asrPinyin == matchPinyin)
+                asr_rect_list.append(asrPinyin);
+        }
+
+        if (asr_rectify)
+            faRes.match_pinyin = asr_rect_list;
+
+        if (asrPinyins != faRes.match_pinyin && !faRes.pinyin_step.empty()) {
+            msg += "\n";
+            msg += "filename: " + filename + "\n";
+            msg += "asr_lab: " + asrPinyins.join(' ') + "\n";
+            msg += "text_res: " + faRes.match_text.join(' ') + "\n";
+            msg += "pyin_res: " + faRes.match_pinyin.join(' ') + "\n";
+            msg += "text_step: " + faRes.text_step.join(' ') + "\n";
+            msg += "pyin_step: " + faRes.pinyin_step.join(' ') + "\n";
+
+            if (asr_rectify && !asr_rect_diff.isEmpty())
+                msg += "asr_rect_diff: " + asr_rect_diff.join(' ');
+            msg += "------------------------";
+        }
+
+        Q_ASSERT(faRes.match_text.size() == faRes.match_pinyin.size());
+
+        QJsonObject writeData;
+        writeData["lab"] = faRes.match_pinyin.join(' ');
+        writeData["raw_text"] = faRes.match_text.join(' ');
+        writeData["lab_without_tone"] = faRes.match_pinyin.join(' ');
+
+        if (!writeJsonFile(jsonPath, writeData)) {
+            msg = QString("Failed to write to file %1").arg(QMFs::PathFindFileName(jsonPath));
+            return false;
+        }
+        return true;
+    }
+
+    QList<MatchLyric::MatchRes> MatchLyric::matchSong(const QList<LabInfo> &segments, const bool &asr_rectify) const {
+        QList<MatchRes> results;
+        for (int i = 0; i < segments.size(); i++)
+            results.append({true, QString()});
+
+        if (segments.isEmpty())
+            return results;
+
+        const auto &first = segments.first().filename;
+        const auto lyricName = first.left(first.lastIndexOf('_'));
+        if (!m_lyricDict.contains(lyricName)) {
+            for (auto &res : results)
+                res = {false, "filename: Miss lyric " + lyricName + ".txt"};
+            return results;
+        }
+
+        const auto textList = m_lyricDict[lyricName].text;
+        const auto pinyinList = m_lyricDict[lyricName].pinyin;
+        const auto g2p = mandarin();
 
-        if (m_lyricDict.contains(lyricName)) {
-            const auto asr_list = get_lyrics_from_txt(labPath);
+        // Segments are aligned together, so only those with a usable ASR result take part.
+        QList<int> alignIndex;
+        QList<QStringList> asrPinyinList;
+        for (int i = 0; i < segments.size(); i++) {
+            const auto asr_list = get_lyrics_from_txt(segments[i].labPath);
             if (asr_list.isEmpty()) {
-                msg = "filename: Asr res is empty.";
-                return false;
+                results[i] = {false, "filename: Asr res is empty."};
+                continue;
             }
-            const auto textList = m_lyricDict[lyricName].text;
-            const auto pinyinList = m_lyricDict[lyricName].pinyin;
-
-            const auto asrG2pRes = m_mandarin->hanziToPinyin(asr_list, false, false);
-            const auto asrPinyins = m_mandarin->resToStringList(asrG2pRes);
+            const auto asrG2pRes = g2p->hanziToPinyin(asr_list, false, false);
+            const auto asrPinyins = g2p->resToStringList(asrG2pRes);
             if (!asrPinyins.isEmpty()) {
-                auto faRes =
-                    LevenshteinDistance::find_similar_substrings(asrPinyins, pinyinList, textList, true, true, true);
-
-                QStringList asr_rect_list;
-                QStringList asr_rect_diff;
-
-                for (int i = 0; i < asrPinyins.size(); i++) {
-                    const auto &asrPinyin = asrPinyins[i];
-                    const auto text = faRes.match_text[i];
-                    const auto matchPinyin = faRes.match_pinyin[i];
-
-                    if (asrPinyin != matchPinyin) {
-                        const QStringList candidate = m_mandarin->getDefaultPinyin(text);
-                        if (candidate.contains(asrPinyin)) {
-                            asr_rect_list.append(asrPinyin);
-                            asr_rect_diff.append("(" + matchPinyin + "->" + asrPinyin + ", " +
-                                                 QString::number(asrPinyins.indexOf(asrPinyin)) + ")");
-                        } else
-                            asr_rect_list.append(matchPinyin);
-                    } else if (asrPinyin == matchPinyin)
-                        asr_rect_list.append(asrPinyin);
-                }
-
-                if (asr_rectify)
-                    faRes.match_pinyin = asr_rect_list;
-
-                if (asrPinyins != faRes.match_pinyin && !faRes.pinyin_step.empty()) {
-                    msg += "\n";
-                    msg += "filename: " + filename + "\n";
-                    msg += "asr_lab: " + asrPinyins.join(' ') + "\n";
-                    msg += "text_res: " + faRes.match_text.join(' ') + "\n";
-                    msg += "pyin_res: " + faRes.match_pinyin.join(' ') + "\n";
-                    msg += "text_step: " + faRes.text_step.join(' ') + "\n";
-                    msg += "pyin_step: " + faRes.pinyin_step.join(' ') + "\n";
-
-                    if (asr_rectify && !asr_rect_diff.isEmpty())
-                        msg += "asr_rect_diff: " + asr_rect_diff.join(' ');
-                    msg += "------------------------";
-                }
-
-                Q_ASSERT(faRes.match_text.size() == faRes.match_pinyin.size());
-
-                QFile jsonFile(jsonPath);
-                QJsonObject writeData;
-                writeData["lab"] = faRes.match_pinyin.join(' ');
-                writeData["raw_text"] = faRes.match_text.join(' ');
-                writeData["lab_without_tone"] = faRes.match_pinyin.join(' ');
-
-                if (!writeJsonFile(jsonPath, writeData)) {
-                    QMessageBox::critical(nullptr, QApplication::applicationName(),
-                                          QString("Failed to write to file %1").arg(QMFs::PathFindFileName(jsonPath)));
-                    return false;
-                }
+                alignIndex.append(i);
+                asrPinyinList.append(asrPinyins);
             }
-        } else {
-            msg = "filename: Miss lyric " + lyricName + ".txt";
-            return false;
         }
-        return true;
+
+        const auto faResList =
+            LevenshteinDistance::align_segments(asrPinyinList, pinyinList, textList, true, true, true);
+
+        for (int k = 0; k < alignIndex.size(); k++) {
+            const auto &segment = segments[alignIndex[k]];
+            auto &res = results[alignIndex[k]];
+            res.success =
+                writeResult(segment.filename, segment.jsonPath, asrPinyinList[k], faResList[k], res.msg, asr_rectify);
+        }
+        return results;
     }
 }
\ No newline at end of file
@@ -5,27 +5,46 @@
 
 #include <QPlainTextEdit>
 #include <QString>
+#include <QThreadStorage>
 
 #include <MandarinG2p.h>
 
+#include "LevenshteinDistance.h"
+
 namespace LyricFA {
     class MatchLyric {
     public:
+        struct LabInfo {
+            QString filename, labPath, jsonPath;
+        };
+
+        struct MatchRes {
+            bool success;
+            QString msg;
+        };
+
         MatchLyric();
         ~MatchLyric();
 
         void initLyric(const QString &lyric_folder);
 
-        bool match(const QString& filename, const QString& labPath, const QString& jsonPath, QString &msg,
-                   const bool &asr_rectify = true) const;
+        // Aligns every segment of one song (same lyric, ordered by the "_NNN" suffix) in a single monotonic pass.
+        // Thread-safe: may be called concurrently once initLyric() has returned.
+        QList<MatchRes> matchSong(const QList<LabInfo> &segments, const bool &asr_rectify = true) const;
 
     private:
+        // MandarinG2p keeps internal caches, so every worker thread gets its own instance.
+        IKg2p::MandarinG2p *mandarin() const;
+
+        bool writeResult(const QString &filename, const QString &jsonPath, const QStringList &asrPinyins, FaRes faRes,
+                         QString &msg, const bool &asr_rectify) const;
+
         struct lyricInfo {
             QStringList text, pinyin;
         };
 
         QMap<QString, lyricInfo> m_lyricDict;
-        std::unique_ptr<IKg2p::MandarinG2p> m_mandarin;
+        mutable QThreadStorage<IKg2p::MandarinG2p *> m_mandarin;
     };
 }
 #endif // MATCHLYRIC_H
@@ -1,6 +1,9 @@
 #include "Common.h"
 #include <QDebug>
 #include <QMessageBox>
+#include <QSet>
+
+#include "QMSystem.h"
 
 typedef QString string;
 QString audioToOtherSuffix(const QString &filename, const QString &tarSuffix) {
@@ -11,35 +14,6 @@ QString audioToOtherSuffix(const QString &filename, const QString &tarSuffix) {
            (suffix != "wav" ? "_" + suffix : "") + "." + tarSuffix;
 }
 
-QString labFileToAudioFile(const QString &filename) {
-    QFileInfo info(filename);
-
-    QString dirPath = info.absolutePath();
-    QString suffix = info.suffix().toLower();
-    QString fileName = info.fileName();
-    QString baseName = fileName.mid(0, fileName.size() - suffix.size() - 1);
-
-    QDir directory(dirPath);
-    QStringList fileTypes;
-    fileTypes << "*.wav"
-              << "*.mp3"
-              << "*.m4a"
-              << "*.flac";
-
-    QStringList audioFiles = directory.entryList(fileTypes, QDir::Files);
-    for (const QString &audioFile : audioFiles) {
-        QFileInfo audioInfo(audioFile);
-        QString audioSuffix = audioInfo.suffix().toLower();
-        QString audioName = audioInfo.fileName();
-        QString audioBaseName = audioName.mid(0, audioName.size() - audioSuffix.size() - 1);
-        if (audioBaseName == baseName) {
-            QString audioFilePath = directory.absoluteFilePath(audioFile);
-            return audioFilePath;
-        }
-    }
-    return "";
-}
-
 bool expFile(const CopyInfo &copyInfo, const QString &item, const QString &suffix, const QString &data) {
     QString target = copyInfo.targetDir + "/" + item + "/" + copyInfo.tarBasename + "." + suffix;
     if (QFile::exists(target)) {
@@ -56,33 +30,21 @@ bool expFile(const CopyInfo &copyInfo, const QString &item, const QString &suffi
     return true;
 }
 
-int jsonCount(const QString &dirName) {
-    QDir directory(dirName);
-    QFileInfoList fileInfoList = directory.entryInfoList(QDir::Files);
-
-    int count = 0;
-    foreach (const QFileInfo &fileInfo, fileInfoList) {
-        if (fileInfo.suffix() == "json" && fileInfo.size() > 0) {
-            count++;
-        }
-    }
-    return count;
-}
-
-bool copyFile(QList<CopyInfo> &copyList, ExportInfo &exportInfo) {
+bool resolveOverwrites(QList<CopyInfo> &copyList) {
     bool overwriteAll = false;
     bool skipAll = false;
 
-    for (const CopyInfo &copyInfo : copyList) {
-        if (copyInfo.exist && !overwriteAll && !skipAll) {
+    for (auto it = copyList.begin(); it != copyList.end();) {
+        if (it->exist && !overwriteAll && !skipAll) {
             QMessageBox::StandardButton reply;
             reply = QMessageBox::question(nullptr, "Overwrite?",
-                                          QString("File %1 already exists, overwrite?").arg(copyInfo.rawName),
+                                          QString("File %1 already exists, overwrite?").arg(it->rawName),
                                           QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel |
                                               QMessageBox::YesToAll | QMessageBox::NoToAll);
             if (reply == QMessageBox::Cancel) {
                 return false;
             } else if (reply == QMessageBox::No) {
+                it = copyList.erase(it);
                 continue;
             } else if (reply == QMessageBox::YesToAll) {
                 overwriteAll = true;
@@ -91,55 +53,53 @@ bool copyFile(QList<CopyInfo> &copyList, ExportInfo &exportInfo) {
             }
         }
 
-        if (!(copyInfo.exist && skipAll)) {
-            QString sourceAudio = copyInfo.sourceDir + "/" + copyInfo.rawName;
-            string sourceJson = audioToOtherSuffix(sourceAudio, "json");
-
-            QString labContent, txtContent, unToneLab;
-            QJsonObject readData;
-            if (readJsonFile(sourceJson, readData)) {
-                txtContent = readData.contains("raw_text") ? readData["raw_text"].toString() : "";
-                labContent = readData.contains("lab") ? readData["lab"].toString() : "";
-                unToneLab = readData.contains("lab_without_tone") ? readData["lab_without_tone"].toString() : "";
-            }
+        if (it->exist && skipAll) {
+            it = copyList.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
 
-            if (exportInfo.exportAudio) {
-                QString targetAudio = copyInfo.targetDir + "/wav/" + copyInfo.tarName;
+bool exportFile(const CopyInfo &copyInfo, const ExportInfo &exportInfo, QString &errorString) {
+    QString sourceAudio = copyInfo.sourceDir + "/" + copyInfo.rawName;
+    string sourceJson = audioToOtherSuffix(sourceAudio, "json");
 
-                if (QFile::exists(targetAudio)) {
-                    QFile::remove(targetAudio);
-                }
+    QString labContent, txtContent, unToneLab;
+    QJsonObject readData;
+    if (readJsonFile(sourceJson, readData)) {
+        txtContent = readData.contains("raw_text") ? readData["raw_text"].toString() : "";
+        labContent = readData.contains("lab") ? readData["lab"].toString() : "";
+        unToneLab = readData.contains("lab_without_tone") ? readData["lab_without_tone"].toString() : "";
+    }
 
-                if (!QFile::copy(sourceAudio, targetAudio)) {
-                    QMessageBox::critical(nullptr, "Copy failed audio",
-                                          QString("Failed to copy file %1, exit").arg(copyInfo.tarName));
-                    return false;
-                }
-            }
+    if (exportInfo.exportAudio) {
+        QString targetAudio = copyInfo.targetDir + "/wav/" + copyInfo.tarName;
+        if (!QMFs::copyFast(sourceAudio, targetAudio)) {
+            errorString = QString("Failed to copy file %1").arg(copyInfo.tarName);
+            return false;
+        }
+    }
 
-            if (exportInfo.labFile) {
-                if (!expFile(copyInfo, "lab", "lab", labContent)) {
-                    QMessageBox::critical(nullptr, "Copy failed lab",
-                                          QString("Failed to copy file %1.%2, exit").arg(copyInfo.tarBasename, "lab"));
-                    return false;
-                }
-            }
+    if (exportInfo.labFile) {
+        if (!expFile(copyInfo, "lab", "lab", labContent)) {
+            errorString = QString("Failed to copy file %1.%2").arg(copyInfo.tarBasename, "lab");
+            return false;
+        }
+    }
 
-            if (exportInfo.rawText) {
-                if (!expFile(copyInfo, "raw_text", "txt", txtContent)) {
-                    QMessageBox::critical(nullptr, "Copy failed raw text",
-                                          QString("Failed to copy file %1.%2, exit").arg(copyInfo.tarBasename, "txt"));
-                    return false;
-                }
-            }
+    if (exportInfo.rawText) {
+        if (!expFile(copyInfo, "raw_text", "txt", txtContent)) {
+            errorString = QString("Failed to copy file %1.%2").arg(copyInfo.tarBasename, "txt");
+            return false;
+        }
+    }
 
-            if (exportInfo.removeTone) {
-                if (!expFile(copyInfo, "lab_without_tone", "lab", unToneLab)) {
-                    QMessageBox::critical(nullptr, "Copy failed lab without tone",
-                                          QString("Failed to make file %1.%2, exit").arg(copyInfo.tarBasename, "lab"));
-                    return false;
-                }
-            }
+    if (exportInfo.removeTone) {
+        if (!expFile(copyInfo, "lab_without_tone", "lab", unToneLab)) {
+            errorString = QString("Failed to make file %1.%2").arg(copyInfo.tarBasename, "lab");
+            return false;
         }
     }
     return true;
@@ -182,26 +142,20 @@ void mkdir(ExportInfo &exportInfo) {
     mkItem(exportInfo.removeTone, folderPath, "lab_without_tone");
 }
 
-QList<CopyInfo> mkCopylist(const QString &sourcePath, const QString &outputDir) {
-    QDir source(sourcePath);
+QList<CopyInfo> mkCopylist(const LabelStatusIndex &index, const QString &sourceDir, const QString &outputDir) {
+    QDir source(sourceDir);
     QDir output(outputDir);
-    QFileInfoList fileInfoList = source.entryInfoList(QDir::Files);
+
+    // One listing of the target instead of a stat per file
+    const QStringList existingList = QDir(output.absolutePath() + "/wav").entryList(QDir::Files);
+    const QSet<QString> existing(existingList.begin(), existingList.end());
 
     QList<CopyInfo> copyList;
-    foreach (const QFileInfo &fileInfo, fileInfoList) {
-        if (fileInfo.suffix() == "json" && fileInfo.size() > 0) {
-            QString audioPath = labFileToAudioFile(fileInfo.absoluteFilePath());
-
-            if (QFile(audioPath).exists()) {
-                QFileInfo audioInfo = QFileInfo(audioPath);
-                QString audioName = audioInfo.fileName();
-
-                QString targetPath = output.absolutePath() + "/wav/" + audioName;
-                CopyInfo copyInfo(audioName, audioName, source.absolutePath(), output.absolutePath(),
-                                  QFile(targetPath).exists());
-                copyList.append(copyInfo);
-            }
-        }
+    const QStringList audioNames = index.labeledAudioFiles(sourceDir);
+    for (const QString &audioName : audioNames) {
+        CopyInfo copyInfo(audioName, audioName, source.absolutePath(), output.absolutePath(),
+                          existing.contains(audioName));
+        copyList.append(copyInfo);
     }
     return copyList;
 }
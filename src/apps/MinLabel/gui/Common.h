@@ -11,8 +11,9 @@
 #include <QStringList>
 #include <utility>
 
+#include "LabelStatusIndex.h"
+
 QString audioToOtherSuffix(const QString &filename, const QString &tarSuffix);
-QString labFileToAudioFile(const QString &filename);
 
 struct ExportInfo {
     QString outputDir;
@@ -40,10 +41,12 @@ struct CopyInfo {
     }
 };
 
-bool copyFile(QList<CopyInfo> &copyList, ExportInfo &exportInfo);
-int jsonCount(const QString &dirName);
+// Asks about every target that exists and drops the skipped ones; false if the user cancels the export.
+bool resolveOverwrites(QList<CopyInfo> &copyList);
+// Exports one file without any UI, so it can run on a worker thread.
+bool exportFile(const CopyInfo &copyInfo, const ExportInfo &exportInfo, QString &errorString);
 void mkdir(ExportInfo &exportInfo);
-QList<CopyInfo> mkCopylist(const QString &sourcePath, const QString &outputDir);
+QList<CopyInfo> mkCopylist(const LabelStatusIndex &index, const QString &sourceDir, const QString &outputDir);
 bool readJsonFile(const QString &fileName, QJsonObject &jsonObject);
 bool writeJsonFile(const QString &fileName, const QJsonObject &jsonObject);
 #endif // DATASET_TOOLS_COMMON_H
@@ -0,0 +1,54 @@
+#include "ExportJob.h"
+
+#include <QThread>
+
+#include <algorithm>
+
+#include "QMFunctionRunnable.h"
+
+ExportJob::ExportJob(QList<CopyInfo> copyList, const ExportInfo &exportInfo, QObject *parent)
+    : QObject(parent), copyList(std::move(copyList)), exportInfo(exportInfo) {
+    // Copying is bound by the disk rather than the CPU, a few files in flight are enough to keep it busy
+    pool.setMaxThreadCount(std::min(QThread::idealThreadCount(), 4));
+}
+
+ExportJob::~ExportJob() {
+    cancel();
+    pool.waitForDone();
+}
+
+void ExportJob::start() {
+    if (copyList.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this]() { emit finished(true, {}); }, Qt::QueuedConnection);
+        return;
+    }
+
+    for (const auto &copyInfo : qAsConst(copyList)) {
+        pool.start(new QMFunctionRunnable([this, copyInfo]() {
+            bool ok = false;
+            QString errorString;
+            if (!canceled.loadAcquire()) {
+                ok = exportFile(copyInfo, exportInfo, errorString);
+                if (!ok) {
+                    canceled.storeRelease(1);
+                }
+            }
+            QMetaObject::invokeMethod(
+                this, [this, ok, errorString]() { fileDone(ok, errorString); }, Qt::QueuedConnection);
+        }));
+    }
+}
+
+void ExportJob::cancel() {
+    canceled.storeRelease(1);
+}
+
+void ExportJob::fileDone(bool ok, const QString &errorString) {
+    if (!ok && firstError.isEmpty()) {
+        firstError = errorString;
+    }
+    emit progress(++done, copyList.size());
+    if (done == copyList.size()) {
+        emit finished(!canceled.loadAcquire(), firstError);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef EXPORTJOB_H
+#define EXPORTJOB_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QThreadPool>
+
+#include "Common.h"
+
+// Exports a resolved copy list on a worker pool. Progress and the result arrive as signals on the thread that owns
+// the job; the first failure cancels whatever has not started yet.
+class ExportJob : public QObject {
+    Q_OBJECT
+public:
+    ExportJob(QList<CopyInfo> copyList, const ExportInfo &exportInfo, QObject *parent = nullptr);
+    ~ExportJob() override;
+
+    void start();
+    void cancel();
+
+signals:
+    void progress(int done, int total);
+    void finished(bool ok, const QString &errorString);
+
+private:
+    void fileDone(bool ok, const QString &errorString);
+
+    QList<CopyInfo> copyList;
+    ExportInfo exportInfo;
+    QThreadPool pool;
+    QAtomicInt canceled;
+    int done = 0;
+    QString firstError;
+};
+
+#endif // EXPORTJOB_H
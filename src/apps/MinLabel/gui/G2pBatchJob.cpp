@@ -0,0 +1,88 @@
+#include "G2pBatchJob.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+
+#include <algorithm>
+
+#include "QMFunctionRunnable.h"
+
+namespace {
+    bool convertFile(const G2pConverter &converter, const G2pOptions &options, const G2pContext &context,
+                     const QString &txtFile, QString &errorString) {
+        QFile txt(txtFile);
+        if (!txt.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            errorString = QString("Failed to read file %1").arg(QFileInfo(txtFile).fileName());
+            return false;
+        }
+        const QString labContent = converter.convert(QString::fromUtf8(txt.readAll()), options, context);
+
+        QFileInfo info(txtFile);
+        QFile lab(info.absolutePath() + "/" + info.completeBaseName() + ".lab");
+        if (!lab.open(QIODevice::WriteOnly | QIODevice::Text) || lab.write(labContent.toUtf8()) == -1) {
+            errorString = QString("Failed to write to file %1").arg(QFileInfo(lab).fileName());
+            return false;
+        }
+        return true;
+    }
+}
+
+G2pBatchJob::G2pBatchJob(QSharedPointer<const G2pConverter> converter, const G2pOptions &options,
+                         QStringList txtFiles, QObject *parent)
+    : QObject(parent), converter(std::move(converter)), options(options), txtFiles(std::move(txtFiles)) {
+}
+
+G2pBatchJob::~G2pBatchJob() {
+    cancel();
+    pool.waitForDone();
+}
+
+void G2pBatchJob::start() {
+    timer.start();
+    if (txtFiles.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this]() { emit finished(0, 0, 0, {}); }, Qt::QueuedConnection);
+        return;
+    }
+
+    const int workers = std::min(QThread::idealThreadCount(), int(txtFiles.size()));
+    pool.setMaxThreadCount(workers);
+    for (int i = 0; i < workers; ++i) {
+        pool.start(new QMFunctionRunnable([this]() {
+            G2pContext context;
+            converter->createContext(context, options.language);
+
+            int index;
+            while ((index = next.fetchAndAddRelaxed(1)) < txtFiles.size()) {
+                bool ok = false;
+                QString errorString;
+                if (!canceled.loadAcquire()) {
+                    ok = convertFile(*converter, options, context, txtFiles.at(index), errorString);
+                }
+                QMetaObject::invokeMethod(
+                    this, [this, ok, errorString]() { fileDone(ok, errorString); }, Qt::QueuedConnection);
+            }
+        }));
+    }
+}
+
+void G2pBatchJob::cancel() {
+    canceled.storeRelease(1);
+}
+
+void G2pBatchJob::fileDone(bool ok, const QString &errorString) {
+    // Files skipped after cancel() come back with neither
+    if (ok) {
+        converted++;
+    } else if (!errorString.isEmpty()) {
+        failed++;
+        if (firstError.isEmpty()) {
+            firstError = errorString;
+        }
+    }
+
+    emit progress(++done, txtFiles.size());
+    if (done == txtFiles.size()) {
+        emit finished(converted, failed, timer.elapsed(), firstError);
+    }
+}
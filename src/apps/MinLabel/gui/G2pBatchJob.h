@@ -0,0 +1,46 @@
+#ifndef G2PBATCHJOB_H
+#define G2PBATCHJOB_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "G2pConverter.h"
+
+// Converts .txt transcripts into .lab files next to them on a worker pool. Every worker creates its G2P context once
+// and then takes files from a shared counter until none are left, so nothing is loaded again per file.
+class G2pBatchJob : public QObject {
+    Q_OBJECT
+public:
+    G2pBatchJob(QSharedPointer<const G2pConverter> converter, const G2pOptions &options, QStringList txtFiles,
+                QObject *parent = nullptr);
+    ~G2pBatchJob() override;
+
+    void start();
+    void cancel();
+
+signals:
+    void progress(int done, int total);
+    // elapsedMs is the wall time from start() to the last file
+    void finished(int converted, int failed, qint64 elapsedMs, const QString &firstError);
+
+private:
+    void fileDone(bool ok, const QString &errorString);
+
+    QSharedPointer<const G2pConverter> converter;
+    G2pOptions options;
+    QStringList txtFiles;
+    QThreadPool pool;
+    QAtomicInt next;
+    QAtomicInt canceled;
+    QElapsedTimer timer;
+    int done = 0;
+    int converted = 0;
+    int failed = 0;
+    QString firstError;
+};
+
+#endif // G2PBATCHJOB_H
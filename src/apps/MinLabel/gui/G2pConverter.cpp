@@ -0,0 +1,94 @@
+#include "G2pConverter.h"
+
+#include <QRegularExpression>
+#include <QTextCodec>
+
+static MeCab::Model *mecabInit(const QString &path, const QString &format) {
+    const QString args = "-O" + format + " -d " + path + " -r" + path + "/mecabrc";
+    return MeCab::createModel(args.toUtf8());
+}
+
+static QString filterSokuon(const QString &input) {
+    static const QRegularExpression regex("[っッ]");
+    QString result = input;
+    return result.replace(regex, "");
+}
+
+G2pConverter::G2pConverter(const QString &mecabDict)
+    : mecabYomi(mecabInit(mecabDict, "yomi")), mecabWakati(mecabInit(mecabDict, "wakati")) {
+}
+
+G2pConverter::~G2pConverter() = default;
+
+void G2pConverter::createContext(G2pContext &context, const G2pOptions::Language language) const {
+    switch (language) {
+        case G2pOptions::Pinyin:
+            if (!context.g2p_man)
+                context.g2p_man.reset(new IKg2p::MandarinG2p());
+            break;
+        case G2pOptions::Romaji:
+            if (!context.g2p_jp)
+                context.g2p_jp.reset(new IKg2p::JapaneseG2p());
+            if (!context.wakati && mecabWakati)
+                context.wakati = mecabWakati->createTagger();
+            if (!context.yomi && mecabYomi)
+                context.yomi = mecabYomi->createTagger();
+            break;
+        case G2pOptions::Cantonese:
+            if (!context.g2p_canton)
+                context.g2p_canton.reset(new IKg2p::CantoneseG2p());
+            break;
+        default:
+            break;
+    }
+}
+
+QString G2pConverter::convert(const QString &sentence, const G2pOptions &options,
+                              const G2pContext &context) const {
+    QString words = sentence;
+    words.replace("\r\n", " ");
+    words.replace("\n", " ");
+
+    QString str;
+    QList<IKg2p::G2pRes> g2pRes;
+    const auto error = options.cleanRes ? IKg2p::errorType::Ignore : IKg2p::errorType::Default;
+    switch (options.language) {
+        case G2pOptions::Pinyin:
+            g2pRes = context.g2p_man->hanziToPinyin(words, options.manTone, options.covertNum, error);
+            str = context.g2p_man->resToStringList(g2pRes).join(' ');
+            break;
+        case G2pOptions::Romaji:
+            str = context.g2p_jp
+                      ->kanaToRomaji(mecabConvert(options.removeSokuon ? filterSokuon(words) : words, context),
+                                     options.doubleConsonant)
+                      .join(' ');
+            break;
+        case G2pOptions::Cantonese:
+            g2pRes = context.g2p_canton->hanziToPinyin(words, options.canTone, options.covertNum, error);
+            str = context.g2p_canton->resToStringList(g2pRes).join(' ');
+            break;
+        default:
+            break;
+    }
+    return str.trimmed().simplified();
+}
+
+QString G2pConverter::mecabConvert(const QString &input, const G2pContext &context) const {
+    if (!context.wakati || !context.yomi)
+        return input;
+
+    const QTextCodec *codec = QTextCodec::codecForName("GBK");
+    const QByteArray mecabRes = context.wakati->parse(codec->fromUnicode(input));
+
+    QStringList out;
+    foreach (auto &it, mecabRes.split(' ')) {
+        QString res = codec->toUnicode(context.yomi->parse(it));
+        const QStringList item = res.split("\t");
+        if (item.size() > 1) {
+            out.append(item[1]);
+        } else if (!item.empty() && item[0] != "") {
+            out.append(item[0]);
+        }
+    }
+    return out.join(" ");
+}
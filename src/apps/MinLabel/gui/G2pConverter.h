@@ -0,0 +1,68 @@
+#ifndef G2PCONVERTER_H
+#define G2PCONVERTER_H
+
+#include <QScopedPointer>
+#include <QString>
+
+#include "CantoneseG2p.h"
+#include "JapaneseG2p.h"
+#include "MandarinG2p.h"
+
+#include "mecab/mecab.h"
+
+struct G2pOptions {
+    enum Language {
+        Pinyin,
+        Romaji,
+        Cantonese,
+    };
+
+    Language language = Pinyin;
+    bool manTone = false;
+    bool canTone = false;
+    bool covertNum = false;
+    bool cleanRes = false;
+    bool removeSokuon = false;
+    bool doubleConsonant = false;
+};
+
+// The parts of a conversion that keep state between calls: a MeCab tagger keeps its parse result inside and the G2P
+// classes keep internal caches, so every thread converting text needs its own set. Only the parts of the languages
+// passed to G2pConverter::createContext() are filled in.
+struct G2pContext {
+    G2pContext() = default;
+    ~G2pContext() {
+        delete wakati;
+        delete yomi;
+    }
+    Q_DISABLE_COPY(G2pContext)
+
+    QScopedPointer<IKg2p::MandarinG2p> g2p_man;
+    QScopedPointer<IKg2p::JapaneseG2p> g2p_jp;
+    QScopedPointer<IKg2p::CantoneseG2p> g2p_canton;
+
+    MeCab::Tagger *wakati = nullptr;
+    MeCab::Tagger *yomi = nullptr;
+};
+
+// The MeCab models, loaded once. convert() only reads them, so it can run on several threads at once as long as
+// each thread passes its own context.
+class G2pConverter {
+public:
+    explicit G2pConverter(const QString &mecabDict = "mecabDict");
+    ~G2pConverter();
+
+    // Adds what converting to language needs to context, unless it is there already.
+    void createContext(G2pContext &context, G2pOptions::Language language) const;
+
+    // context must have been created for options.language.
+    QString convert(const QString &sentence, const G2pOptions &options, const G2pContext &context) const;
+
+private:
+    QString mecabConvert(const QString &input, const G2pContext &context) const;
+
+    QScopedPointer<MeCab::Model> mecabYomi;
+    QScopedPointer<MeCab::Model> mecabWakati;
+};
+
+#endif // G2PCONVERTER_H
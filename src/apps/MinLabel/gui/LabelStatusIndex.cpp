@@ -0,0 +1,202 @@
+#include "LabelStatusIndex.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+
+#include "Common.h"
+#include "QMFunctionRunnable.h"
+
+namespace {
+    void splitPath(const QString &path, QString &dirname, QString &filename) {
+        const int slash = path.lastIndexOf('/');
+        dirname = path.left(slash);
+        filename = path.mid(slash + 1);
+    }
+
+    QString dirKey(const QString &dirname) {
+        return QDir(dirname).absolutePath();
+    }
+}
+
+LabelStatusIndex::LabelStatusIndex(QObject *parent) : QObject(parent) {
+    pool.setMaxThreadCount(1);
+    clock.start();
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(DebounceMs);
+    connect(&debounceTimer, &QTimer::timeout, this, &LabelStatusIndex::scanChanged);
+    // A single save renames and removes temporary files, each of which is reported
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString &dirname) {
+        if (!dirs.contains(dirname))
+            return;
+        if (!changedDirs.contains(dirname))
+            changedDirs.insert(dirname, clock.elapsed());
+        debounceTimer.start();
+    });
+}
+
+LabelStatusIndex::~LabelStatusIndex() {
+    pool.clear();
+    pool.waitForDone();
+}
+
+void LabelStatusIndex::setDirectory(const QString &dirname) {
+    generation++;
+    dirs.clear();
+    changedDirs.clear();
+    debounceTimer.stop();
+    if (!watcher.directories().isEmpty())
+        watcher.removePaths(watcher.directories());
+    scan(dirKey(dirname));
+    emit changed();
+}
+
+void LabelStatusIndex::refresh(const QString &dirname) {
+    const QString key = dirKey(dirname);
+    auto &dir = dirs[key];
+    if (!watcher.directories().contains(key))
+        watcher.addPath(key);
+    apply(dir, list(key));
+    // A listing running now started earlier, list again once it is done instead of taking its result
+    if (dir.scanning)
+        dir.rescan = true;
+    emit changed();
+}
+
+bool LabelStatusIndex::isLabeled(const QString &audioFile) {
+    QString dirname, filename;
+    splitPath(audioToOtherSuffix(audioFile, "json"), dirname, filename);
+    auto it = dirs.constFind(dirname);
+    if (it == dirs.constEnd()) {
+        // A subdirectory expanded in the tree
+        scan(dirname);
+        return false;
+    }
+    return it->labeled.contains(filename);
+}
+
+int LabelStatusIndex::audioCount(const QString &dirname) const {
+    const auto it = dirs.constFind(dirKey(dirname));
+    return it == dirs.constEnd() ? 0 : it->audio.size();
+}
+
+int LabelStatusIndex::labeledCount(const QString &dirname) const {
+    const auto it = dirs.constFind(dirKey(dirname));
+    return it == dirs.constEnd() ? 0 : it->labeledAudio;
+}
+
+QStringList LabelStatusIndex::labeledAudioFiles(const QString &dirname) const {
+    QStringList files;
+    const auto it = dirs.constFind(dirKey(dirname));
+    if (it == dirs.constEnd())
+        return files;
+    for (auto audio = it->audio.constBegin(); audio != it->audio.constEnd(); ++audio) {
+        if (it->labeled.contains(audio.key()))
+            files.append(audio.value());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+void LabelStatusIndex::update(const QString &jsonFile) {
+    QString dirname, filename;
+    splitPath(jsonFile, dirname, filename);
+    auto it = dirs.find(dirname);
+    if (it == dirs.end())
+        return;
+    it->ownWrite = clock.elapsed();
+    if (!jsonFile.endsWith(".json"))
+        return;
+
+    QFileInfo info(jsonFile);
+    const bool wasLabeled = it->labeled.contains(filename);
+    const bool labeled = info.isFile() && info.size() > 0;
+    if (labeled)
+        it->labeled.insert(filename);
+    else
+        it->labeled.remove(filename);
+    if (labeled != wasLabeled && it->audio.contains(filename))
+        it->labeledAudio += labeled ? 1 : -1;
+    // A listing running now may have missed this file, list again once it is done
+    if (it->scanning)
+        it->rescan = true;
+    emit changed();
+}
+
+LabelStatusIndex::Listing LabelStatusIndex::list(const QString &dirname) {
+    static const QStringList audioSuffixes{"wav", "mp3", "m4a", "flac"};
+
+    Listing listing;
+    // Sorted by name, so of two audio files sharing a json the first one is kept like a directory listing would
+    const auto entries = QDir(dirname).entryInfoList(QDir::Files, QDir::Name | QDir::IgnoreCase);
+    for (const auto &entry : entries) {
+        const QString suffix = entry.suffix();
+        if (suffix == "json") {
+            if (entry.size() > 0)
+                listing.labeled.insert(entry.fileName());
+        } else if (audioSuffixes.contains(suffix, Qt::CaseInsensitive)) {
+            QString jsonDir, jsonName;
+            splitPath(audioToOtherSuffix(entry.absoluteFilePath(), "json"), jsonDir, jsonName);
+            if (!listing.audio.contains(jsonName))
+                listing.audio.insert(jsonName, entry.fileName());
+        }
+    }
+    return listing;
+}
+
+void LabelStatusIndex::apply(Directory &dir, const Listing &listing) {
+    dir.labeled = listing.labeled;
+    dir.audio = listing.audio;
+    dir.labeledAudio = 0;
+    for (auto it = dir.audio.constBegin(); it != dir.audio.constEnd(); ++it) {
+        if (dir.labeled.contains(it.key()))
+            dir.labeledAudio++;
+    }
+}
+
+void LabelStatusIndex::scanChanged() {
+    const auto changed = changedDirs;
+    changedDirs.clear();
+    for (auto it = changed.constBegin(); it != changed.constEnd(); ++it) {
+        const auto dir = dirs.constFind(it.key());
+        if (dir == dirs.constEnd())
+            continue;
+        // Saved by MinLabel while the events came in: update() has seen the file already
+        if (dir->ownWrite >= 0 && dir->ownWrite >= it.value() - OwnWriteSlackMs)
+            continue;
+        scan(it.key());
+    }
+}
+
+void LabelStatusIndex::scan(const QString &dirname) {
+    auto &dir = dirs[dirname];
+    if (dir.scanning) {
+        dir.rescan = true;
+        return;
+    }
+    dir.scanning = true;
+    dir.rescan = false;
+    if (!watcher.directories().contains(dirname))
+        watcher.addPath(dirname);
+
+    const quint64 generation = this->generation;
+    pool.start(new QMFunctionRunnable([this, dirname, generation]() {
+        const Listing listing = list(dirname);
+        QMetaObject::invokeMethod(
+            this,
+            [this, dirname, generation, listing]() {
+                auto it = dirs.find(dirname);
+                if (generation != this->generation || it == dirs.end())
+                    return;
+                it->scanning = false;
+                if (it->rescan) {
+                    scan(dirname);
+                    return;
+                }
+                apply(*it, listing);
+                emit changed();
+            },
+            Qt::QueuedConnection);
+    }));
+}
@@ -0,0 +1,78 @@
+#ifndef LABELSTATUSINDEX_H
+#define LABELSTATUSINDEX_H
+
+#include <QElapsedTimer>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+// The audio files of each directory and which of them already have a non-empty json label, so the file tree, the
+// progress and the export never touch the disk per file. Audio files are matched to their json with
+// audioToOtherSuffix(), like everywhere else. A directory is listed on a background thread the first time one of its
+// files is asked for, then kept current by watching it and by update() after each save. Until the listing arrives
+// it has no files. Watcher events are gathered for a moment before listing again, and those of a directory MinLabel
+// just saved to itself are dropped, update() already covers them.
+class LabelStatusIndex : public QObject {
+    Q_OBJECT
+public:
+    explicit LabelStatusIndex(QObject *parent = nullptr);
+    ~LabelStatusIndex() override;
+
+    // Forgets everything indexed so far and starts listing dirname.
+    void setDirectory(const QString &dirname);
+
+    // Lists dirname again right away, e.g. before an export when files may have been added outside MinLabel.
+    void refresh(const QString &dirname);
+
+    bool isLabeled(const QString &audioFile);
+
+    // Number of audio files in dirname, and how many of them are labeled.
+    int audioCount(const QString &dirname) const;
+    int labeledCount(const QString &dirname) const;
+    // File names of the labeled audio files in dirname, sorted.
+    QStringList labeledAudioFiles(const QString &dirname) const;
+
+    // Re-reads the status of one json file, e.g. after it was written. Any other file only marks its directory as
+    // written by MinLabel.
+    void update(const QString &jsonFile);
+
+signals:
+    // Some statuses changed, visible rows and the progress should be refreshed.
+    void changed();
+
+private:
+    struct Listing {
+        QSet<QString> labeled;          // File names of the non-empty json files
+        QHash<QString, QString> audio;  // Audio file name by the file name of its json
+    };
+
+    struct Directory : Listing {
+        int labeledAudio = 0;
+        bool scanning = false;
+        bool rescan = false;
+        qint64 ownWrite = -1; // clock time of the last save by MinLabel
+    };
+
+    static Listing list(const QString &dirname);
+    void apply(Directory &dir, const Listing &listing);
+    void scan(const QString &dirname);
+    void scanChanged();
+
+    static constexpr int DebounceMs = 500;
+    // Events up to this long before a save of MinLabel landed are taken as caused by it
+    static constexpr int OwnWriteSlackMs = 1000;
+
+    QHash<QString, Directory> dirs;
+    QFileSystemWatcher watcher;
+    QTimer debounceTimer;
+    QElapsedTimer clock;
+    QHash<QString, qint64> changedDirs; // clock time of the first event since the last listing
+    QThreadPool pool;
+    quint64 generation = 0;
+};
+
+#endif // LABELSTATUSINDEX_H
@@ -10,17 +10,22 @@
 #include <QMenuBar>
 #include <QMessageBox>
 #include <QMimeData>
+#include <QProgressDialog>
 #include <QStatusBar>
 #include <QStyledItemDelegate>
 #include <QTime>
+#include <algorithm>
 #include <utility>
 
+#include "ExportJob.h"
+#include "G2pBatchJob.h"
 #include "QMSystem.h"
 #include "qasglobal.h"
 
 class CustomDelegate : public QStyledItemDelegate {
 public:
-    explicit CustomDelegate(QObject *parent = nullptr) : QStyledItemDelegate(parent) {
+    explicit CustomDelegate(LabelStatusIndex *labelIndex, QObject *parent = nullptr)
+        : QStyledItemDelegate(parent), labelIndex(labelIndex) {
     }
 
     void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override {
@@ -29,11 +34,9 @@ public:
             return;
         }
 
-        QFileInfo fileInfo(model->filePath(index));
-        QString jsonFilePath = fileInfo.absolutePath() + "/" + fileInfo.completeBaseName() + ".json";
-
+        // Both lookups are in memory, painting must not stat files
         QStyleOptionViewItem modifiedOption(option);
-        if (QFile::exists(jsonFilePath) && fileInfo.isFile() && QFileInfo(jsonFilePath).size() > 0) {
+        if (!model->isDir(index) && labelIndex->isLabeled(model->filePath(index))) {
             modifiedOption.palette.setColor(QPalette::Text, Qt::gray);
         } else {
             modifiedOption.palette.setColor(QPalette::Text, Qt::black);
@@ -41,6 +44,9 @@ public:
 
         QStyledItemDelegate::paint(painter, modifiedOption, index);
     }
+
+private:
+    LabelStatusIndex *labelIndex;
 };
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
@@ -56,6 +62,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     covertAction = new QAction("Covert lab to project file", this);
 
+    g2pAction = new QAction("Convert txt to lab in folder", this);
+
     exportAction = new QAction("Export", this);
     exportAction->setShortcut(QKeySequence("Ctrl+E"));
 
@@ -63,6 +71,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     fileMenu->addAction(browseAction);
     fileMenu->addAction(exportAction);
     fileMenu->addAction(covertAction);
+    fileMenu->addAction(g2pAction);
 
     nextAction = new QAction("Next file", this);
     nextAction->setShortcut(QKeySequence::MoveToNextPage);
@@ -117,7 +126,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     treeView = new QTreeView();
     treeView->setModel(fsModel);
-    treeView->setItemDelegate(new CustomDelegate(treeView));
+    treeView->setItemDelegate(new CustomDelegate(&labelIndex, treeView));
 
     {
         QSet<QString> names{"Name", "Size"};
@@ -154,6 +163,17 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     connect(treeView->selectionModel(), &QItemSelectionModel::currentChanged, this, &MainWindow::_q_treeCurrentChanged);
     connect(treeView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &MainWindow::_q_updateProgress);
 
+    connect(&saveQueue, &QMSaveQueue::saved, &labelIndex, &LabelStatusIndex::update);
+    connect(&labelIndex, &LabelStatusIndex::changed, treeView->viewport(), QOverload<>::of(&QWidget::update));
+    connect(&labelIndex, &LabelStatusIndex::changed, this, &MainWindow::_q_updateProgress);
+    connect(&saveQueue, &QMSaveQueue::saveFailed, this, [this](const QString &filename, const QString &errorString) {
+        QMessageBox::critical(this, qApp->applicationName(),
+                              QString("Failed to write to file %1 (%2).\n\n"
+                                      "The label is kept in the folder's journal and will be written again\n"
+                                      "with the next save or when the folder is opened again.")
+                                  .arg(QMFs::PathFindFileName(filename), errorString));
+    });
+
     reloadWindowTitle();
     resize(1280, 720);
 
@@ -206,6 +226,8 @@ MainWindow::~MainWindow() {
 }
 
 void MainWindow::openDirectory(const QString &dirName) {
+    saveQueue.setDirectory(dirName);
+    labelIndex.setDirectory(dirName);
     fsModel->setRootPath(dirName);
     treeView->setRootIndex(fsModel->index(dirName));
 }
@@ -215,7 +237,17 @@ void MainWindow::openFile(const QString &filename) {
 
     QString jsonFilePath = audioToOtherSuffix(filename, "json");
     QJsonObject readData;
-    if (readJsonFile(jsonFilePath, readData)) {
+    QByteArray queued;
+    bool hasData = false;
+    if (saveQueue.pending(jsonFilePath, &queued)) {
+        // Saved a moment ago and not on disk yet
+        auto doc = QJsonDocument::fromJson(queued);
+        hasData = doc.isObject();
+        readData = doc.object();
+    } else {
+        hasData = readJsonFile(jsonFilePath, readData);
+    }
+    if (hasData) {
         txtContent = readData.contains("raw_text") ? readData["raw_text"].toString() : "";
         labContent = readData.contains("lab") ? readData["lab"].toString() : "";
     }
@@ -240,39 +272,26 @@ void MainWindow::saveFile(const QString &filename) {
 
     QString jsonFilePath = audioToOtherSuffix(filename, "json");
 
-    if (labContent.isEmpty() && txtContent.isEmpty() && !QMFs::isFileExist(jsonFilePath)) {
+    if (labContent.isEmpty() && txtContent.isEmpty() && !QMFs::isFileExist(jsonFilePath) &&
+        !saveQueue.pending(jsonFilePath)) {
         return;
     }
 
-    QFile jsonFile(jsonFilePath);
     QJsonObject writeData;
     writeData["lab"] = labContent.replace(QRegExp("\\s+"), " ");
     writeData["raw_text"] = txtContent;
     writeData["lab_without_tone"] = withoutTone.replace(QRegExp("\\s+"), " ");
 
-    if (!writeJsonFile(jsonFilePath, writeData)) {
-        QMessageBox::critical(this, qApp->applicationName(),
-                              QString("Failed to write to file %1").arg(QMFs::PathFindFileName(jsonFilePath)));
-        ::exit(-1);
-    }
+    // Written in the background, failures are reported by saveQueue
+    saveQueue.save(jsonFilePath, QJsonDocument(writeData).toJson(), true);
 
     QString labFilePath = audioToOtherSuffix(filename, "lab");
 
-    if (labContent.isEmpty() && !QMFs::isFileExist(labFilePath)) {
+    if (labContent.isEmpty() && !QMFs::isFileExist(labFilePath) && !saveQueue.pending(labFilePath)) {
         return;
     }
 
-    QFile labFile(labFilePath);
-    if (!labFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::critical(this, qApp->applicationName(),
-                              QString("Failed to write to file %1").arg(QMFs::PathFindFileName(labFilePath)));
-        ::exit(-1);
-    }
-
-    QTextStream labIn(&labFile);
-    labIn.setCodec(QTextCodec::codecForName("UTF-8"));
-    labIn << labContent;
-    labFile.close();
+    saveQueue.save(labFilePath, labContent.toUtf8(), true);
 }
 
 void MainWindow::reloadWindowTitle() {
@@ -397,6 +416,13 @@ void MainWindow::_q_fileMenuTriggered(QAction *action) {
             }
             labToJson(path);
         }
+    } else if (action == g2pAction) {
+        playerWidget->setPlaying(false);
+        QString path = QFileDialog::getExistingDirectory(this, "Open Transcript Folder", dirname);
+        if (path.isEmpty()) {
+            return;
+        }
+        txtToLab(path);
     } else if (action == exportAction) {
         playerWidget->setPlaying(false);
         ExportDialog dialog(this);
@@ -434,8 +460,8 @@ void MainWindow::_q_helpMenuTriggered(QAction *action) {
 }
 
 void MainWindow::_q_updateProgress() {
-    int count = jsonCount(dirname);
-    int totalRowCount = static_cast<int>(fsModel->rootDirectory().count());
+    int count = labelIndex.labeledCount(dirname);
+    int totalRowCount = labelIndex.audioCount(dirname);
     double progress = 0.0;
     if (totalRowCount > 0) {
         progress = (static_cast<double>(count) / totalRowCount) * 100.0;
@@ -456,8 +482,11 @@ void MainWindow::_q_treeCurrentChanged(const QModelIndex &current) {
 }
 
 void MainWindow::exportAudio(ExportInfo &exportInfo) {
-    int count = jsonCount(dirname);
-    int totalRowCount = static_cast<int>(fsModel->rootDirectory().count());
+    saveQueue.flush();
+    // Files may have been added outside MinLabel, list the folder again once for the whole export
+    labelIndex.refresh(dirname);
+    int count = labelIndex.labeledCount(dirname);
+    int totalRowCount = labelIndex.audioCount(dirname);
     if (totalRowCount != count) {
         QMessageBox::StandardButton reply;
         reply = QMessageBox::question(this, qApp->applicationName(),
@@ -469,16 +498,47 @@ void MainWindow::exportAudio(ExportInfo &exportInfo) {
     }
 
     mkdir(exportInfo);
-    QList<CopyInfo> copyList = mkCopylist(dirname, exportInfo.outputDir + "/" + exportInfo.folderName);
-    if (copyFile(copyList, exportInfo)) {
-        QMessageBox::information(this, qApp->applicationName(), QString("Successfully exported files."));
-    } else {
-        QMessageBox::critical(this, qApp->applicationName(), QString("Failed to export files."));
+    QList<CopyInfo> copyList = mkCopylist(labelIndex, dirname, exportInfo.outputDir + "/" + exportInfo.folderName);
+    if (!resolveOverwrites(copyList)) {
+        return;
     }
+
+    // Copies run in the background, the dialog only shows progress and offers to cancel
+    auto job = new ExportJob(copyList, exportInfo, this);
+    auto dialog = new QProgressDialog("Exporting files...", "Cancel", 0, copyList.size(), this);
+    dialog->setWindowTitle(qApp->applicationName());
+    dialog->setWindowModality(Qt::WindowModal);
+    dialog->setMinimumDuration(0);
+    dialog->setAutoClose(false);
+    dialog->setAutoReset(false);
+
+    connect(job, &ExportJob::progress, dialog, &QProgressDialog::setValue);
+    connect(dialog, &QProgressDialog::canceled, job, &ExportJob::cancel);
+    connect(job, &ExportJob::finished, this, [this, job, dialog](bool ok, const QString &errorString) {
+        dialog->deleteLater();
+        job->deleteLater();
+        if (ok) {
+            QMessageBox::information(this, qApp->applicationName(), QString("Successfully exported files."));
+        } else if (!errorString.isEmpty()) {
+            QMessageBox::critical(this, qApp->applicationName(),
+                                  QString("Failed to export files.\n\n%1").arg(errorString));
+        }
+    });
+
+    dialog->show();
+    job->start();
 }
 void MainWindow::labToJson(const QString &dirName) {
+    saveQueue.flush();
     QDir directory(dirName);
     QFileInfoList fileInfoList = directory.entryInfoList(QDir::Files);
+    // Which json files exist, from the same listing instead of a stat per lab file
+    QSet<QString> jsonFiles;
+    for (const QFileInfo &fileInfo : qAsConst(fileInfoList)) {
+        if (fileInfo.suffix() == "json") {
+            jsonFiles.insert(fileInfo.fileName());
+        }
+    }
 
     int count = 0;
     foreach (const QFileInfo &fileInfo, fileInfoList) {
@@ -487,7 +547,7 @@ void MainWindow::labToJson(const QString &dirName) {
         QString suffix = fileInfo.suffix().toLower();
         QString name = fileInfo.fileName();
         QString jsonFilePath = fileInfo.absolutePath() + "/" + name.mid(0, name.size() - suffix.size() - 1) + ".json";
-        if (fileInfo.suffix() == "lab" && !QMFs::isFileExist(jsonFilePath)) {
+        if (fileInfo.suffix() == "lab" && !jsonFiles.contains(name.mid(0, name.size() - suffix.size() - 1) + ".json")) {
             QFile file(labFilePath);
             QString labContent, txtContent;
             if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -507,18 +567,13 @@ void MainWindow::labToJson(const QString &dirName) {
                         withoutTone = inputList.join(" ");
                     }
 
-                    QFile jsonFile(jsonFilePath);
                     QJsonObject writeData;
                     writeData["lab"] = labContent.replace(QRegExp("\\s+"), " ");
                     writeData["raw_text"] = txtContent;
                     writeData["lab_without_tone"] = withoutTone.replace(QRegExp("\\s+"), " ");
 
-                    if (!writeJsonFile(jsonFilePath, writeData)) {
-                        QMessageBox::critical(
-                            this, qApp->applicationName(),
-                            QString("Failed to write to file %1").arg(QMFs::PathFindFileName(jsonFilePath)));
-                        ::exit(-1);
-                    }
+                    // Written in the background like every save, failures are reported by saveQueue
+                    saveQueue.save(jsonFilePath, QJsonDocument(writeData).toJson(), true);
                 }
                 count++;
             }
@@ -528,3 +583,71 @@ void MainWindow::labToJson(const QString &dirName) {
     QMessageBox::information(this, qApp->applicationName(),
                              QString("Convert %1 lab files to current project file.").arg(count));
 }
+
+void MainWindow::txtToLab(const QString &dirName) {
+    QDir directory(dirName);
+    QStringList txtFiles;
+    int existing = 0;
+    const QFileInfoList fileInfoList = directory.entryInfoList({"*.txt"}, QDir::Files);
+    for (const QFileInfo &fileInfo : fileInfoList) {
+        txtFiles.append(fileInfo.absoluteFilePath());
+        if (directory.exists(fileInfo.completeBaseName() + ".lab")) {
+            existing++;
+        }
+    }
+    if (txtFiles.isEmpty()) {
+        QMessageBox::information(this, qApp->applicationName(), "No txt file in this folder.");
+        return;
+    }
+
+    if (existing > 0) {
+        auto reply = QMessageBox::question(
+            this, qApp->applicationName(),
+            QString("%1 lab files already exist, overwrite them?\n\nChoose No to convert only the other files.")
+                .arg(existing),
+            QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+        if (reply == QMessageBox::Cancel) {
+            return;
+        } else if (reply == QMessageBox::No) {
+            txtFiles.erase(std::remove_if(txtFiles.begin(), txtFiles.end(),
+                                          [](const QString &txtFile) {
+                                              QFileInfo info(txtFile);
+                                              return QFile::exists(info.absolutePath() + "/" +
+                                                                   info.completeBaseName() + ".lab");
+                                          }),
+                           txtFiles.end());
+        }
+    }
+
+    // Uses the language and options currently chosen in the text widget
+    auto job = new G2pBatchJob(textWidget->g2pConverter(), textWidget->g2pOptions(), txtFiles, this);
+    auto dialog = new QProgressDialog("Converting transcripts...", "Cancel", 0, txtFiles.size(), this);
+    dialog->setWindowTitle(qApp->applicationName());
+    dialog->setWindowModality(Qt::WindowModal);
+    dialog->setMinimumDuration(0);
+    dialog->setAutoClose(false);
+    dialog->setAutoReset(false);
+
+    connect(job, &G2pBatchJob::progress, dialog, &QProgressDialog::setValue);
+    connect(dialog, &QProgressDialog::canceled, job, &G2pBatchJob::cancel);
+    connect(job, &G2pBatchJob::finished, this,
+            [this, job, dialog](int converted, int failed, qint64 elapsedMs, const QString &firstError) {
+                dialog->deleteLater();
+                job->deleteLater();
+
+                const double seconds = elapsedMs / 1000.0;
+                QString message = QString("Converted %1 txt files to lab in %2 s (%3 files/s).")
+                                      .arg(converted)
+                                      .arg(seconds, 0, 'f', 2)
+                                      .arg(seconds > 0 ? converted / seconds : 0.0, 0, 'f', 1);
+                if (failed > 0) {
+                    message += QString("\n\n%1 files failed, the first one: %2").arg(failed).arg(firstError);
+                    QMessageBox::warning(this, qApp->applicationName(), message);
+                } else {
+                    QMessageBox::information(this, qApp->applicationName(), message);
+                }
+            });
+
+    dialog->show();
+    job->start();
+}
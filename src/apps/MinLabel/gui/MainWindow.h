@@ -18,10 +18,13 @@
 
 #include "Common.h"
 #include "ExportDialog.h"
+#include "LabelStatusIndex.h"
 #include "PlayWidget.h"
 #include "TextWidget.h"
 #include "inc/MinLabelCfg.h"
 
+#include "QMSaveQueue.h"
+
 #include "Api/IAudioDecoder.h"
 #include "Api/IAudioPlayback.h"
 
@@ -35,6 +38,7 @@ protected:
     QMenu *fileMenu;
     QAction *browseAction;
     QAction *covertAction;
+    QAction *g2pAction;
     QAction *exportAction;
 
     QMenu *editMenu;
@@ -69,11 +73,14 @@ protected:
     QString lastFile;
 
     MinLabelCfg cfg;
+    QMSaveQueue saveQueue;
+    LabelStatusIndex labelIndex;
 
     void openDirectory(const QString &dirName);
     void openFile(const QString &filename);
     void saveFile(const QString &filename);
     void labToJson(const QString &dirName);
+    void txtToLab(const QString &dirName);
     void exportAudio(ExportInfo &exportInfo);
 
     void reloadWindowTitle();
@@ -3,13 +3,10 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QDebug>
-#include <QRegularExpression>
-#include <QTextCodec>
 
-TextWidget::TextWidget(QWidget *parent)
-    : QWidget(parent), g2p_man(new IKg2p::MandarinG2p()), g2p_jp(new IKg2p::JapaneseG2p()),
-      g2p_canton(new IKg2p::CantoneseG2p()), mecabYomi(mecabInit("mecabDict", "yomi")),
-      mecabWakati(mecabInit("mecabDict", "wakati")) {
+TextWidget::TextWidget(QWidget *parent) : QWidget(parent), converter(new G2pConverter()) {
+    converter->createContext(context, G2pOptions::Pinyin);
+
     wordsText = new QLineEdit();
     wordsText->setPlaceholderText("Enter mandarin here...");
 
@@ -90,13 +87,6 @@ TextWidget::TextWidget(QWidget *parent)
 
 TextWidget::~TextWidget() = default;
 
-QString TextWidget::sentence() const {
-    QString words = wordsText->text();
-    words.replace("\r\n", " ");
-    words.replace("\n", " ");
-    return words;
-}
-
 void TextWidget::_q_pasteButtonClicked() const {
     const auto board = QApplication::clipboard();
     const QString text = board->text();
@@ -105,64 +95,30 @@ void TextWidget::_q_pasteButtonClicked() const {
     }
 }
 
-QString filterSokuon(const QString &input) {
-    static QRegularExpression regex("[っッ]");
-    QString result = input;
-    return result.replace(regex, "");
+QSharedPointer<const G2pConverter> TextWidget::g2pConverter() const {
+    return converter;
+}
+
+G2pOptions TextWidget::g2pOptions() const {
+    G2pOptions options;
+    options.language = static_cast<G2pOptions::Language>(languageCombo->currentIndex());
+    options.manTone = manTone->isChecked();
+    options.canTone = canTone->isChecked();
+    options.covertNum = covertNum->isChecked();
+    options.cleanRes = cleanRes->isChecked();
+    options.removeSokuon = removeSokuon->isChecked();
+    options.doubleConsonant = doubleConsonant->isChecked();
+    return options;
 }
 
 void TextWidget::_q_replaceButtonClicked() const {
-    QString str;
-    QList<IKg2p::G2pRes> g2pRes;
-    const QString jpInput = removeSokuon->isChecked() ? filterSokuon(sentence()) : sentence();
-    switch (languageCombo->currentIndex()) {
-        case 0:
-            g2pRes =
-                g2p_man->hanziToPinyin(sentence(), manTone->isChecked(), covertNum->isChecked(),
-                                       cleanRes->isChecked() ? IKg2p::errorType::Ignore : IKg2p::errorType::Default);
-            str = g2p_man->resToStringList(g2pRes).join(' ');
-            break;
-        case 1:
-            str = g2p_jp->kanaToRomaji(mecabConvert(jpInput), doubleConsonant->isChecked()).join(' ');
-            break;
-        case 2:
-            g2pRes =
-                g2p_canton->hanziToPinyin(sentence(), canTone->isChecked(), covertNum->isChecked(),
-                                          cleanRes->isChecked() ? IKg2p::errorType::Ignore : IKg2p::errorType::Default);
-            str = g2p_canton->resToStringList(g2pRes).join(' ');
-            break;
-        default:
-            break;
-    }
-    contentText->setPlainText(str.trimmed().simplified());
+    contentText->setPlainText(converter->convert(wordsText->text(), g2pOptions(), context));
 }
 
 void TextWidget::_q_appendButtonClicked() const {
-    QString str;
-    QList<IKg2p::G2pRes> g2pRes;
-    const QString jpInput = removeSokuon->isChecked() ? filterSokuon(sentence()) : sentence();
-    switch (languageCombo->currentIndex()) {
-        case 0:
-            g2pRes =
-                g2p_man->hanziToPinyin(sentence(), manTone->isChecked(), covertNum->isChecked(),
-                                       cleanRes->isChecked() ? IKg2p::errorType::Ignore : IKg2p::errorType::Default);
-            str = g2p_man->resToStringList(g2pRes).join(' ');
-            break;
-        case 1:
-            str = g2p_jp->kanaToRomaji(mecabConvert(jpInput), doubleConsonant->isChecked()).join(' ');
-            break;
-        case 2:
-            g2pRes =
-                g2p_canton->hanziToPinyin(sentence(), canTone->isChecked(), covertNum->isChecked(),
-                                          cleanRes->isChecked() ? IKg2p::errorType::Ignore : IKg2p::errorType::Default);
-            str = g2p_canton->resToStringList(g2pRes).join(' ');
-            break;
-        default:
-            break;
-    }
-
+    const QString str = converter->convert(wordsText->text(), g2pOptions(), context);
     const QString org = contentText->toPlainText();
-    contentText->setPlainText((org.isEmpty() ? "" : org + " ") + str.trimmed().simplified());
+    contentText->setPlainText((org.isEmpty() ? "" : org + " ") + str);
 }
 
 void TextWidget::_q_onLanguageComboIndexChanged() {
@@ -172,6 +128,8 @@ void TextWidget::_q_onLanguageComboIndexChanged() {
         {"cantonese", {canTone, covertNum, cleanRes} }
     };
 
+    converter->createContext(context, static_cast<G2pOptions::Language>(languageCombo->currentIndex()));
+
     const QString selectedLanguage = languageCombo->currentText();
     for (auto it = optionMap.begin(); it != optionMap.end(); ++it) {
         for (QCheckBox *control : it.value()) {
@@ -184,25 +142,3 @@ void TextWidget::_q_onLanguageComboIndexChanged() {
         control->show();
     }
 }
-
-MeCab::Tagger *TextWidget::mecabInit(const QString &path, const QString &format) {
-    const QString args = "-O" + format + " -d " + path + " -r" + path + "/mecabrc";
-    return MeCab::createTagger(args.toUtf8());
-}
-
-QString TextWidget::mecabConvert(const QString &input) const {
-    const QTextCodec *codec = QTextCodec::codecForName("GBK");
-    const QByteArray mecabRes = mecabWakati->parse(codec->fromUnicode(input));
-
-    QStringList out;
-    foreach (auto &it, mecabRes.split(' ')) {
-        QString res = codec->toUnicode(mecabYomi->parse(it));
-        const QStringList item = res.split("\t");
-        if (item.size() > 1) {
-            out.append(item[1]);
-        } else if (!item.empty() && item[0] != "") {
-            out.append(item[0]);
-        }
-    }
-    return out.join(" ");
-}
\ No newline at end of file
@@ -8,14 +8,12 @@
 #include <QPlainTextEdit>
 #include <QProcess>
 #include <QPushButton>
+#include <QSharedPointer>
 #include <QVBoxLayout>
 #include <QWidget>
 
-#include "CantoneseG2p.h"
-#include "JapaneseG2p.h"
-#include "MandarinG2p.h"
+#include "G2pConverter.h"
 
-#include "mecab/mecab.h"
 class TextWidget final : public QWidget {
     Q_OBJECT
 public:
@@ -25,6 +23,11 @@ public:
     QLineEdit *wordsText;
     QPlainTextEdit *contentText;
 
+    // The converter and options the buttons use, for converting whole folders the same way. The converter is shared
+    // so a running batch keeps it alive.
+    QSharedPointer<const G2pConverter> g2pConverter() const;
+    G2pOptions g2pOptions() const;
+
 protected:
     QPushButton *replaceButton;
     QPushButton *appendButton;
@@ -48,17 +51,10 @@ protected:
     QHBoxLayout *optionsLayout;
     QVBoxLayout *mainLayout;
 
-    QScopedPointer<IKg2p::MandarinG2p> g2p_man;
-    QScopedPointer<IKg2p::JapaneseG2p> g2p_jp;
-    QScopedPointer<IKg2p::CantoneseG2p> g2p_canton;
+    QSharedPointer<G2pConverter> converter;
+    G2pContext context;
 
 private:
-    MeCab::Tagger *mecabYomi;
-    MeCab::Tagger *mecabWakati;
-    [[nodiscard]] QString sentence() const;
-    static MeCab::Tagger *mecabInit(const QString &path = "mecabDict", const QString &format = "wakati");
-    [[nodiscard]] QString mecabConvert(const QString &input) const;
-
     void _q_pasteButtonClicked() const;
     void _q_replaceButtonClicked() const;
     void _q_appendButtonClicked() const;
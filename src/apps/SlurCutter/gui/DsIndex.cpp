@@ -0,0 +1,243 @@
+#include "DsIndex.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include "DsNumbers.h"
+
+namespace {
+    // Minimal JSON walker: it only finds where values begin and end, validation is left to QJsonDocument when a
+    // sentence is actually parsed.
+    class Scanner {
+    public:
+        explicit Scanner(const QByteArray &content)
+            : m_data(content.constData()), m_pos(0), m_size(content.size()) {
+        }
+
+        int pos() const {
+            return m_pos;
+        }
+
+        bool atEnd() const {
+            return m_pos >= m_size;
+        }
+
+        void advance(int count) {
+            m_pos += count;
+        }
+
+        char peek() const {
+            return atEnd() ? '\0' : m_data[m_pos];
+        }
+
+        void skipSpace() {
+            while (!atEnd() && (m_data[m_pos] == ' ' || m_data[m_pos] == '\t' || m_data[m_pos] == '\n' ||
+                                m_data[m_pos] == '\r'))
+                m_pos++;
+        }
+
+        bool consume(char c) {
+            skipSpace();
+            if (peek() != c)
+                return false;
+            m_pos++;
+            return true;
+        }
+
+        // Steps over a string whose opening quote is at pos().
+        bool skipString() {
+            m_pos++;
+            while (!atEnd()) {
+                const char c = m_data[m_pos++];
+                if (c == '\\')
+                    m_pos++;
+                else if (c == '"')
+                    return true;
+            }
+            return false;
+        }
+
+        // Steps over any value; nested containers are matched by depth only.
+        bool skipValue() {
+            skipSpace();
+            const char c = peek();
+            if (c == '"')
+                return skipString();
+            if (c == '{' || c == '[') {
+                int depth = 0;
+                while (!atEnd()) {
+                    const char d = m_data[m_pos];
+                    if (d == '"') {
+                        if (!skipString())
+                            return false;
+                        continue;
+                    }
+                    m_pos++;
+                    if (d == '{' || d == '[') {
+                        depth++;
+                    } else if (d == '}' || d == ']') {
+                        if (--depth == 0)
+                            return true;
+                    }
+                }
+                return false;
+            }
+            // Number, true, false or null
+            const int begin = m_pos;
+            while (!atEnd() && peek() != ',' && peek() != '}' && peek() != ']' && peek() != ' ' &&
+                   peek() != '\n' && peek() != '\r' && peek() != '\t')
+                m_pos++;
+            return m_pos > begin;
+        }
+
+        QByteArray slice(int begin, int end) const {
+            return QByteArray(m_data + begin, end - begin);
+        }
+
+    private:
+        const char *m_data;
+        int m_pos;
+        int m_size;
+    };
+}
+
+bool indexDsContent(const QByteArray &content, QVector<DsSentenceIndex> &index, QString &errorString) {
+    index.clear();
+    Scanner scanner(content);
+
+    // Skip a UTF-8 BOM
+    if (content.startsWith("\xEF\xBB\xBF"))
+        scanner.advance(3);
+
+    if (!scanner.consume('[')) {
+        errorString = "Top level is not an array";
+        return false;
+    }
+    if (scanner.consume(']')) {
+        return true;
+    }
+
+    while (true) {
+        scanner.skipSpace();
+        const int begin = scanner.pos();
+        if (scanner.peek() == '{') {
+            scanner.consume('{');
+
+            // Raw JSON of the three fields the list needs, decoded together below
+            QByteArray text, noteDur, offset;
+            if (!scanner.consume('}')) {
+                while (true) {
+                    scanner.skipSpace();
+                    const int keyBegin = scanner.pos();
+                    if (scanner.peek() != '"' || !scanner.skipString()) {
+                        errorString = QString("Malformed object at byte %1").arg(keyBegin);
+                        return false;
+                    }
+                    const QByteArray key = scanner.slice(keyBegin, scanner.pos());
+                    if (!scanner.consume(':')) {
+                        errorString = QString("Expected ':' at byte %1").arg(scanner.pos());
+                        return false;
+                    }
+
+                    scanner.skipSpace();
+                    const int valueBegin = scanner.pos();
+                    if (!scanner.skipValue()) {
+                        errorString = QString("Malformed value at byte %1").arg(valueBegin);
+                        return false;
+                    }
+                    if (key == "\"text\"")
+                        text = scanner.slice(valueBegin, scanner.pos());
+                    else if (key == "\"note_dur\"")
+                        noteDur = scanner.slice(valueBegin, scanner.pos());
+                    else if (key == "\"offset\"")
+                        offset = scanner.slice(valueBegin, scanner.pos());
+
+                    if (scanner.consume('}'))
+                        break;
+                    if (!scanner.consume(',')) {
+                        errorString = QString("Expected ',' or '}' at byte %1").arg(scanner.pos());
+                        return false;
+                    }
+                }
+            }
+
+            if (!text.isEmpty() && !noteDur.isEmpty() && !offset.isEmpty()) {
+                const auto fields =
+                    QJsonDocument::fromJson("[" + text + "," + noteDur + "," + offset + "]").array();
+                DsSentenceIndex sentence;
+                sentence.begin = begin;
+                sentence.end = scanner.pos();
+                sentence.text = fields.at(0).toString();
+                const QString noteDuration = fields.at(1).toString();
+                sentence.offset = fields.at(2).toDouble(-1);
+                if (!sentence.text.isEmpty() && !noteDuration.isEmpty() && sentence.offset != -1) {
+                    QVector<double> noteDurs;
+                    parseDsNumbers(noteDuration, noteDurs);
+                    for (const double dur : noteDurs)
+                        sentence.duration += dur;
+                    index.append(sentence);
+                }
+            }
+        } else if (!scanner.skipValue()) {
+            errorString = QString("Malformed value at byte %1").arg(begin);
+            return false;
+        }
+
+        if (scanner.consume(']'))
+            return true;
+        if (!scanner.consume(',')) {
+            errorString = QString("Expected ',' or ']' at byte %1").arg(scanner.pos());
+            return false;
+        }
+    }
+}
+
+bool parseDsSentence(const QByteArray &content, const DsSentenceIndex &sentence, QJsonObject &object,
+                     QString &errorString) {
+    QJsonParseError err;
+    const auto doc = QJsonDocument::fromJson(
+        QByteArray::fromRawData(content.constData() + sentence.begin, sentence.end - sentence.begin), &err);
+    if (err.error != QJsonParseError::NoError || !doc.isObject()) {
+        errorString = QString("Failed to parse JSON: %1").arg(err.errorString());
+        return false;
+    }
+    object = doc.object();
+    return true;
+}
+
+QByteArray spliceDsSentences(const QByteArray &content, QVector<DsSentenceIndex> &index,
+                             const QVector<QJsonObject> &objects, const QVector<bool> &dirty) {
+    const QByteArray eol = content.contains("\r\n") ? QByteArray("\r\n") : QByteArray("\n");
+
+    QByteArray result;
+    result.reserve(content.size() + content.size() / 8);
+    int copied = 0;
+    for (int i = 0; i < index.size(); ++i) {
+        auto &sentence = index[i];
+        result.append(content.constData() + copied, sentence.begin - copied);
+        const int begin = result.size();
+        if (!dirty[i]) {
+            result.append(content.constData() + sentence.begin, sentence.end - sentence.begin);
+        } else {
+            // Continuation lines take the indentation of the line the object starts on
+            int lineStart = sentence.begin;
+            while (lineStart > 0 && content[lineStart - 1] != '\n')
+                --lineStart;
+            QByteArray indent = content.mid(lineStart, sentence.begin - lineStart);
+            for (char &c : indent)
+                if (c != '\t')
+                    c = ' ';
+
+            auto json = QJsonDocument(objects[i]).toJson(QJsonDocument::Indented);
+            while (json.endsWith('\n'))
+                json.chop(1);
+            json.replace("\n", eol + indent);
+            result.append(json);
+        }
+        copied = sentence.end;
+        sentence.begin = begin;
+        sentence.end = result.size();
+    }
+    result.append(content.constData() + copied, content.size() - copied);
+    return result;
+}
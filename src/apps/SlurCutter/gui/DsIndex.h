@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QVector>
+
+// One sentence of a .ds file, located without building its QJsonObject.
+struct DsSentenceIndex {
+    int begin = 0; // byte range of the sentence object in the file
+    int end = 0;
+    QString text;
+    double offset = 0.0;
+    double duration = 0.0; // sum of note_dur
+};
+
+// Walks the top level array of a .ds file and indexes every sentence the sentence list can show (non-empty text
+// and note_dur, numeric offset); anything else is skipped like before. Only text, note_dur and offset are decoded,
+// f0_seq and the other large fields are stepped over.
+bool indexDsContent(const QByteArray &content, QVector<DsSentenceIndex> &index, QString &errorString);
+
+// Parses one indexed sentence into a full object.
+bool parseDsSentence(const QByteArray &content, const DsSentenceIndex &sentence, QJsonObject &object,
+                     QString &errorString);
+
+// Rebuilds the file with the sentences marked in dirty re-serialized from objects and every other byte kept as it
+// was, so unchanged sentences, skipped entries and formatting survive a save. The byte ranges in index are moved to
+// the returned content.
+QByteArray spliceDsSentences(const QByteArray &content, QVector<DsSentenceIndex> &index,
+                             const QVector<QJsonObject> &objects, const QVector<bool> &dirty);
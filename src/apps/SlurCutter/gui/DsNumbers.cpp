@@ -0,0 +1,51 @@
+#include "DsNumbers.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <charconv>
+
+static bool isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool parseDouble(const char *begin, const char *end, double &value) {
+    // from_chars rejects the explicit plus sign that toDouble() accepts
+    if (begin != end && *begin == '+')
+        ++begin;
+#if defined(__cpp_lib_to_chars)
+    const auto res = std::from_chars(begin, end, value);
+    return res.ec == std::errc() && res.ptr == end;
+#else
+    // Not locale dependent, unlike strtod
+    bool ok = false;
+    value = QByteArray::fromRawData(begin, static_cast<int>(end - begin)).toDouble(&ok);
+    return ok;
+#endif
+}
+
+bool parseDsNumbers(const QString &field, QVector<double> &values) {
+    // Number fields are plain ASCII, so the Latin-1 bytes are the UTF-8 bytes
+    const QByteArray bytes = field.toLatin1();
+    const char *cursor = bytes.constData();
+    const char *end = cursor + bytes.size();
+
+    values.clear();
+    values.reserve(static_cast<int>(std::count(cursor, end, ' ')) + 1);
+
+    bool ok = true;
+    while (true) {
+        cursor = std::find_if_not(cursor, end, isSeparator);
+        if (cursor == end)
+            break;
+        const char *tokenEnd = std::find_if(cursor, end, isSeparator);
+        double value;
+        if (!parseDouble(cursor, tokenEnd, value)) {
+            value = 0;
+            ok = false;
+        }
+        values.append(value);
+        cursor = tokenEnd;
+    }
+    return ok;
+}
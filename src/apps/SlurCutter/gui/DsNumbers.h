@@ -0,0 +1,8 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+// Parses a space separated DS number field ("0.12 0.3 ...") into `values`, reserving once and filling in place.
+// Malformed tokens become 0, as QString::toDouble() would give; the return value tells whether any were found.
+bool parseDsNumbers(const QString &field, QVector<double> &values);
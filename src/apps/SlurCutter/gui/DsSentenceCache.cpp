@@ -0,0 +1,66 @@
+#include "DsSentenceCache.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+
+static constexpr quint32 CacheMagic = 0x53434630; // "SCF0"
+static constexpr quint32 CacheVersion = 1;
+
+quint64 DsSentenceCache::keyOf(const QString &f0Seq) {
+    // Two differently seeded hashes plus the length make accidental collisions practically impossible
+    return (quint64(qHash(f0Seq, 0x9e3779b9u)) << 32 | qHash(f0Seq, 0x85ebca6bu)) ^ quint64(f0Seq.size());
+}
+
+void DsSentenceCache::open(const QString &dsPath) {
+    m_path = dsPath + ".f0cache";
+    m_entries.clear();
+    m_dirty = false;
+
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (magic != CacheMagic || version != CacheVersion)
+        return;
+
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    QHash<quint64, QVector<double>> entries;
+    stream >> entries;
+    if (stream.status() == QDataStream::Ok)
+        m_entries = std::move(entries);
+}
+
+bool DsSentenceCache::save() {
+    if (!m_dirty || m_path.isEmpty())
+        return true;
+
+    QSaveFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+    stream << CacheMagic << CacheVersion << m_entries;
+    if (stream.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    m_dirty = false;
+    return true;
+}
+
+bool DsSentenceCache::lookup(const QString &f0Seq, QVector<double> &f0Values) const {
+    auto it = m_entries.constFind(keyOf(f0Seq));
+    if (it == m_entries.constEnd())
+        return false;
+    f0Values = it.value();
+    return true;
+}
+
+void DsSentenceCache::insert(const QString &f0Seq, const QVector<double> &f0Values) {
+    m_entries.insert(keyOf(f0Seq), f0Values);
+    m_dirty = true;
+}
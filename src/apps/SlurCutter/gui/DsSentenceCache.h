@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+// Parsed f0 curves (already converted to MIDI pitch) of the sentences of one .ds file, kept in memory and in a
+// binary sidecar next to it ("<name>.ds.f0cache"), so reopening a sentence skips parsing f0_seq. Entries are keyed
+// by a hash of the raw f0_seq text, so a curve edited outside SlurCutter simply misses.
+class DsSentenceCache {
+public:
+    // Drops the current entries and loads the sidecar of dsPath, if there is one.
+    void open(const QString &dsPath);
+    // Writes the sidecar if entries were added since it was loaded.
+    bool save();
+
+    bool lookup(const QString &f0Seq, QVector<double> &f0Values) const;
+    void insert(const QString &f0Seq, const QVector<double> &f0Values);
+
+private:
+    static quint64 keyOf(const QString &f0Seq);
+
+    QString m_path;
+    QHash<quint64, QVector<double>> m_entries;
+    bool m_dirty = false;
+};
@@ -10,16 +10,18 @@
 
 
 #include <QtWidgets/qaction.h>
+#include <algorithm>
 #include <cmath>
 
 
+#include "DsNumbers.h"
 #include "DsSentence.h"
 #include "F0Widget.h"
 #include "gui/F0Widget.h"
 #include "qjsonstream.h"
 
 
-F0Widget::F0Widget(QWidget *parent) : QFrame(parent), draggingNoteInterval(0, 0), contextMenuNoteInterval(0, 0, {}) {
+F0Widget::F0Widget(QWidget *parent) : QFrame(parent), draggingNoteInterval(0, 0) {
     hasError = false;
     assert(FrequencyToMidiNote(440.0) == 69.0);
     assert(FrequencyToMidiNote(110.0) == 45.0);
@@ -123,6 +125,7 @@ F0Widget::F0Widget(QWidget *parent) : QFrame(parent), draggingNoteInterval(0, 0)
     });
     connect(bgMenuShowPhonemeTexts, &QAction::triggered, [=]() {
         showPhonemeTexts = bgMenuShowPhonemeTexts->isChecked();
+        invalidateStaticLayer();
         update();
     });
     connect(bgMenuSnapByDefault, &QAction::triggered, [=]() {
@@ -144,17 +147,23 @@ void F0Widget::setDsSentenceContent(const QJsonObject &content) {
     QAS::JsonStream stream(content);
     stream >> sentence;
 
-    auto f0Seq = sentence.f0_seq.split(" ", QString::SkipEmptyParts);
-    foreach (auto f0, f0Seq) {
-        f0Values.append(FrequencyToMidiNote(f0.toDouble()));
+    if (!sentenceCache || !sentenceCache->lookup(sentence.f0_seq, f0Values)) {
+        parseDsNumbers(sentence.f0_seq, f0Values);
+        for (auto &f0 : f0Values) {
+            f0 = FrequencyToMidiNote(f0);
+        }
+        if (sentenceCache)
+            sentenceCache->insert(sentence.f0_seq, f0Values);
     }
     f0Timestep = sentence.f0_timestep.toDouble();
 
+    QVector<double> phDur, noteDur;
+    parseDsNumbers(sentence.ph_dur, phDur);
+    parseDsNumbers(sentence.note_dur, noteDur);
+
     auto phSeq = sentence.ph_seq.split(" ", QString::SkipEmptyParts);
-    auto phDur = sentence.ph_dur.split(" ", QString::SkipEmptyParts);
     auto phNum = sentence.ph_num.split(" ", QString::SkipEmptyParts);
     auto noteSeq = sentence.note_seq.split(" ", QString::SkipEmptyParts);
-    auto noteDur = sentence.note_dur.split(" ", QString::SkipEmptyParts);
     auto text = sentence.text.split(" ", QString::SkipEmptyParts);
     auto slur = sentence.note_slur.split(" ", QString::SkipEmptyParts);
     auto glide = sentence.note_glide.split(" ");
@@ -213,38 +222,39 @@ void F0Widget::setDsSentenceContent(const QJsonObject &content) {
     auto noteBegin = 0.0;
     auto phBegin = 0.0;
     int ph_j = 0;
+    midiNotes.reserve(noteSeq.size(), showPhonemeTexts ? phDur.size() : 0);
     for (int i = 0; i < noteSeq.size(); i++) {
-        MiniNote note;
-        note.duration = noteDur[i].toDouble();
+        double duration = noteDur[i];
+        int pitch;
+        double cents;
         // Parse note pitch
         auto notePitch = noteSeq[i];
         if (notePitch.contains(QRegularExpression(R"((\+|\-))"))) {
             auto splitPitch = notePitch.split(QRegularExpression(R"((\+|\-))"));
-            note.pitch = NoteNameToMidiNote(splitPitch[0]);
-            note.cents = splitPitch[1].toDouble();
-            note.cents *= (notePitch[splitPitch[0].length()] == '+' ? 1 : -1);
+            pitch = NoteNameToMidiNote(splitPitch[0]);
+            cents = splitPitch[1].toDouble();
+            cents *= (notePitch[splitPitch[0].length()] == '+' ? 1 : -1);
         } else {
-            note.pitch = NoteNameToMidiNote(noteSeq[i]);
-            note.cents = NAN;
+            pitch = NoteNameToMidiNote(noteSeq[i]);
+            cents = NAN;
         }
-        note.isSlur = !slur.empty() && (slur[i].toInt() > 0);
-        note.isRest = isRest[i];
-        if (glide.size() - 1 < i || glide[i] == "none") note.glide = GlideStyle::None;
-        else if (glide[i] == "up") note.glide = GlideStyle::Up;
-        else if (glide[i] == "down") note.glide = GlideStyle::Down;
+        GlideStyle noteGlide = GlideStyle::None;
+        if (glide.size() - 1 < i || glide[i] == "none") noteGlide = GlideStyle::None;
+        else if (glide[i] == "up") noteGlide = GlideStyle::Up;
+        else if (glide[i] == "down") noteGlide = GlideStyle::Down;
+        midiNotes.append(duration, pitch, cents, !slur.empty() && (slur[i].toInt() > 0), isRest[i], noteGlide);
         if (showPhonemeTexts) {
-            while (ph_j < phDur.size() && phBegin >= noteBegin - 0.01 && phBegin < noteBegin + note.duration - 0.01) {
-                MiniPhonome ph;
+            while (ph_j < phDur.size() && phBegin >= noteBegin - 0.01 && phBegin < noteBegin + duration - 0.01) {
+                NotePhoneme ph;
                 ph.begin = phBegin;
-                ph.duration = phDur[ph_j].toDouble();
+                ph.duration = phDur[ph_j];
                 ph.ph = phSeq[ph_j];
-                note.phonemes.append(ph);
+                midiNotes.appendPhoneme(ph);
                 ph_j++;
                 phBegin += ph.duration;
             }
         }
-        midiIntervals.insert({noteBegin, noteBegin + note.duration, note});
-        noteBegin += note.duration;
+        noteBegin += duration;
     }
 
     // Update ranges
@@ -257,11 +267,37 @@ void F0Widget::setDsSentenceContent(const QJsonObject &content) {
 
     isEmpty = false;
 
+    // Min/max pyramid of the curve for zoomed out views; level k covers 2^(k+1) samples per bucket
+    f0Mipmap.clear();
+    if (f0Values.size() > 1) {
+        QVector<std::pair<double, double>> level(f0Values.size() / 2);
+        for (int i = 0; i < level.size(); i++)
+            level[i] = std::minmax(f0Values[2 * i], f0Values[2 * i + 1]);
+        if (f0Values.size() % 2)
+            level.append({f0Values.last(), f0Values.last()});
+        f0Mipmap.append(level);
+        while (f0Mipmap.last().size() > 1) {
+            const auto &prev = f0Mipmap.last();
+            QVector<std::pair<double, double>> next((prev.size() + 1) / 2);
+            for (int i = 0; i < next.size(); i++) {
+                const auto &a = prev[2 * i];
+                const auto &b = 2 * i + 1 < prev.size() ? prev[2 * i + 1] : a;
+                next[i] = {std::min(a.first, b.first), std::max(a.second, b.second)};
+            }
+            f0Mipmap.append(next);
+        }
+    }
+
     setF0CenterAndSyncScrollbar(f0Values.first());
 
+    invalidateStaticLayer();
     update();
 }
 
+void F0Widget::setSentenceCache(DsSentenceCache *cache) {
+    sentenceCache = cache;
+}
+
 void F0Widget::setErrorStatusText(const QString &text) {
     hasError = true;
     errorStatusText = text;
@@ -277,6 +313,7 @@ void F0Widget::loadConfig(const SlurCutterCfg &cfg) {
     showPitchTextOverlay = cfg.showPitchTextOverlay;
     showPhonemeTexts = cfg.showPhonemeTexts;
 
+    invalidateStaticLayer();
     update();
 }
 
@@ -289,43 +326,59 @@ void F0Widget::pullConfig(SlurCutterCfg &cfg) const {
 void F0Widget::clear() {
     hasError = false;
     errorStatusText = "";
-    midiIntervals.clear();
+    midiNotes.clear();
     f0Values.clear();
+    f0Mipmap.clear();
     isEmpty = true;
+    modified = false;
     // phonemeIntervals.clear();
     // textIntervals.clear();
+    invalidateStaticLayer();
     update();
 }
 
 F0Widget::ReturnedDsString F0Widget::getSavedDsStrings() {
     ReturnedDsString ret;
-    for (auto &i : midiIntervals.intervals()) {
-        ret.note_dur += QString::number(i.value.duration, 'g', 3) + ' ';
-        ret.note_slur += i.value.isSlur ? "1 " : "0 ";
-        ret.note_seq += i.value.isRest
-                            ? "rest "
-                            : (std::isnan(i.value.cents)
-                                   ? (MidiNoteToNoteName(i.value.pitch) + ' ')
-                                   : (PitchToNotePlusCentsString(i.value.pitch + 0.01 * i.value.cents) + ' '));
-        if (i.value.isRest) {
+    // Sized for the longest entries ("0.125 ", "C#4+50 ", "none ") so the fields are built without reallocating
+    const int n = midiNotes.size();
+    ret.note_dur.reserve(n * 8);
+    ret.note_seq.reserve(n * 8);
+    ret.note_slur.reserve(n * 2);
+    ret.note_glide.reserve(n * 5);
+    for (int i = 0; i < n; i++) {
+        if (i > 0) {
+            ret.note_dur += ' ';
+            ret.note_seq += ' ';
+            ret.note_slur += ' ';
+            ret.note_glide += ' ';
+        }
+        ret.note_dur += QString::number(midiNotes.duration(i), 'g', 3);
+        ret.note_slur += midiNotes.isSlur(i) ? '1' : '0';
+        if (midiNotes.isRest(i))
+            ret.note_seq += QLatin1String("rest");
+        else if (std::isnan(midiNotes.cents(i)))
+            ret.note_seq += MidiNoteToNoteName(midiNotes.pitch(i));
+        else
+            ret.note_seq += PitchToNotePlusCentsString(midiNotes.pitch(i) + 0.01 * midiNotes.cents(i));
+        if (midiNotes.isRest(i)) {
             // rest notes must have no glides
-            ret.note_glide += "none ";
+            ret.note_glide += QLatin1String("none");
         }
         else {
-            switch (i.value.glide) {
-                case GlideStyle::None: ret.note_glide += "none "; break;
-                case GlideStyle::Up: ret.note_glide += "up "; break;
-                case GlideStyle::Down: ret.note_glide += "down "; break;
+            switch (midiNotes.glide(i)) {
+                case GlideStyle::None: ret.note_glide += QLatin1String("none"); break;
+                case GlideStyle::Up: ret.note_glide += QLatin1String("up"); break;
+                case GlideStyle::Down: ret.note_glide += QLatin1String("down"); break;
             }
         }
     }
-    ret.note_dur = ret.note_dur.trimmed();
-    ret.note_seq = ret.note_seq.trimmed();
-    ret.note_slur = ret.note_slur.trimmed();
-    ret.note_glide = ret.note_glide.trimmed();
     return ret;
 };
 
+bool F0Widget::isModified() const {
+    return modified;
+}
+
 bool F0Widget::empty() {
     return isEmpty;
 }
@@ -398,17 +451,14 @@ std::tuple<size_t, size_t> F0Widget::refF0IndexRange(double startTime, double en
 }
 
 
-bool F0Widget::mouseOnNote(const QPoint &mousePos, MiniNoteInterval *returnNote) const {
-    auto w = width() - KeyWidth - ScrollBarWidth, h = height() - TimelineHeight;
+bool F0Widget::mouseOnNote(const QPoint &mousePos, int *returnNote) const {
     auto mouseTime = timeOnWidgetX(mousePos.x());
     auto mousePitch = pitchOnWidgetY(mousePos.y());
 
-    auto matchedNotes = midiIntervals.findOverlappingIntervals({mouseTime, mouseTime}, true);
-    if (matchedNotes.empty())
-        return false;
-
-    for (auto &i : matchedNotes) {
-        double pitch = i.value.pitch + (std::isnan(i.value.cents) ? 0 : i.value.cents / 100);
+    // At most two notes: the one under the cursor, or both neighbours when it sits exactly on a boundary
+    auto matchedNotes = midiNotes.overlapping(mouseTime, mouseTime);
+    for (int i = matchedNotes.first; i < matchedNotes.second; i++) {
+        double pitch = midiNotes.pitch(i) + (std::isnan(midiNotes.cents(i)) ? 0 : midiNotes.cents(i) / 100);
         if (mousePitch >= pitch - 0.5 && mousePitch <= pitch + 0.5) {
             if (returnNote)
                 *returnNote = i;
@@ -429,87 +479,57 @@ double F0Widget::timeOnWidgetX(int x) const {
 }
 
 void F0Widget::setNoteContextMenuEntriesEnabled() {
-    auto noteInterval = contextMenuNoteInterval;
-    // auto leftIntervals = midiIntervals.findOverlappingIntervals({noteInterval.low - 0.1, noteInterval.low}, false);
-    auto rightIntervals = midiIntervals.findOverlappingIntervals({noteInterval.high, noteInterval.high + 0.1}, false);
-
     // Only slurs can be merged to left
-    noteMenuMergeLeft->setEnabled(noteInterval.value.isSlur);
+    noteMenuMergeLeft->setEnabled(midiNotes.isSlur(contextMenuNote) && contextMenuNote > 0);
 }
 
 void F0Widget::splitNoteUnderMouse() {
-    MiniNoteInterval noteInterval{-1, -1};
+    int note = -1;
     auto cursorPos = mapFromGlobal(QCursor::pos());
 
-    if (mouseOnNote(cursorPos, &noteInterval) && !noteInterval.value.isRest) {
+    if (mouseOnNote(cursorPos, &note) && !midiNotes.isRest(note)) {
         auto time = timeOnWidgetX(cursorPos.x());
+        if (time <= midiNotes.begin(note) || time >= midiNotes.end(note))
+            return;
 
-        MiniNote leftNote{noteInterval.value}, rightNote{noteInterval.value};
-        leftNote.duration = time - noteInterval.low;
-        rightNote.duration = noteInterval.high - time;
-        rightNote.isSlur = true;
-        leftNote.phonemes.clear();
-        rightNote.phonemes.clear();
-        for (auto &ph : noteInterval.value.phonemes) {
-            if (ph.begin >= noteInterval.low && ph.begin < time) {
-                leftNote.phonemes.append(ph);
-            }
-            else if (ph.begin >= time && ph.begin < noteInterval.high) {
-                rightNote.phonemes.append(ph);
-            }
-        }
-
-        midiIntervals.remove(noteInterval);
-        midiIntervals.insert({noteInterval.low, time, leftNote});
-        midiIntervals.insert({time, noteInterval.high, rightNote});
+        midiNotes.split(note, time);
 
+        modified = true;
+        invalidateStaticLayer();
         update();
     }
 }
 
 void F0Widget::shiftDraggedNoteByPitch(double pitchDelta) {
-    auto intervals =
-        midiIntervals.findInnerIntervals({std::get<0>(draggingNoteInterval), std::get<1>(draggingNoteInterval)});
-    if (intervals.empty())
+    if (draggingNote < 0 || draggingNote >= midiNotes.size())
         return;
 
-    auto &note = intervals[0].value;
-    double addedCents = draggingNoteInCents ? (std::isnan(note.cents) ? 0 : note.cents) : 0;
+    double cents = midiNotes.cents(draggingNote);
+    double addedCents = draggingNoteInCents ? (std::isnan(cents) ? 0 : cents) : 0;
     double semitoneDelta, newCents;
     newCents = 100 * ::modf(pitchDelta + 0.01 * addedCents, &semitoneDelta);
 
-    note.cents = newCents;
-    note.pitch += semitoneDelta;
-
-    midiIntervals.remove(intervals[0]);
-    midiIntervals.insert(intervals[0]);
+    midiNotes.setPitch(draggingNote, int(midiNotes.pitch(draggingNote) + semitoneDelta), newCents);
+    modified = true;
+    invalidateStaticLayer();
 }
 
 void F0Widget::setDraggedNotePitch(int pitch) {
-    auto intervals =
-        midiIntervals.findInnerIntervals({std::get<0>(draggingNoteInterval), std::get<1>(draggingNoteInterval)});
-    if (intervals.empty())
+    if (draggingNote < 0 || draggingNote >= midiNotes.size())
         return;
 
-    auto &note = intervals[0].value;
-    note.pitch = pitch;
-    note.cents = NAN;
-
-    midiIntervals.remove(intervals[0]);
-    midiIntervals.insert(intervals[0]);
+    midiNotes.setPitch(draggingNote, pitch, NAN);
+    modified = true;
+    invalidateStaticLayer();
 }
 
 void F0Widget::setDraggedNoteGlide(GlideStyle style) {
-        auto intervals =
-        midiIntervals.findInnerIntervals({std::get<0>(draggingNoteInterval), std::get<1>(draggingNoteInterval)});
-    if (intervals.empty())
+    if (draggingNote < 0 || draggingNote >= midiNotes.size())
         return;
 
-    auto &note = intervals[0].value;
-    note.glide = style;
-
-    midiIntervals.remove(intervals[0]);
-    midiIntervals.insert(intervals[0]);
+    midiNotes.setGlide(draggingNote, style);
+    modified = true;
+    invalidateStaticLayer();
 }
 
 void F0Widget::modeChanged(bool checked) {
@@ -518,30 +538,30 @@ void F0Widget::modeChanged(bool checked) {
 }
 
 void F0Widget::convertAllRestsToNormal() {
-    for (auto &i : midiIntervals.intervals()) {
-        if (i.value.isRest) {
-            midiIntervals.remove(i);
-            i.value.isRest = false;
-            midiIntervals.insert(i);
-        }
-    }
+    for (int i = 0; i < midiNotes.size(); i++)
+        midiNotes.setRest(i, false);
+    modified = true;
+    invalidateStaticLayer();
     update();
 }
 
 void F0Widget::setMenuFromCurrentNote() {
-    auto note = contextMenuNoteInterval.value;
-    noteMenuSetGlideType->setEnabled(!note.isRest);
-    if (note.isRest) {
+    if (contextMenuNote < 0 || contextMenuNote >= midiNotes.size())
+        return;
+    auto glide = midiNotes.glide(contextMenuNote);
+    auto isRest = midiNotes.isRest(contextMenuNote);
+    noteMenuSetGlideType->setEnabled(!isRest);
+    if (isRest) {
         noteMenuSetGlideNone->setChecked(true);
     }
     else {
-        if (note.glide == GlideStyle::None) {
+        if (glide == GlideStyle::None) {
             noteMenuSetGlideNone->setChecked(true);
         }
-        else if (note.glide == GlideStyle::Up) {
+        else if (glide == GlideStyle::Up) {
             noteMenuSetGlideUp->setChecked(true);
         }
-        else if (note.glide == GlideStyle::Down) {
+        else if (glide == GlideStyle::Down) {
             noteMenuSetGlideDown->setChecked(true);
         }
     }
@@ -550,30 +570,23 @@ void F0Widget::setMenuFromCurrentNote() {
 void F0Widget::mergeCurrentSlurToLeftNode(bool checked) {
     Q_UNUSED(checked);
 
-    auto noteInterval = contextMenuNoteInterval;
-
-    auto intervals = midiIntervals.findOverlappingIntervals({noteInterval.low - 0.1, noteInterval.low}, false);
-    if (intervals.empty())
+    if (contextMenuNote <= 0 || contextMenuNote >= midiNotes.size())
         return;
-    auto leftNode = intervals.back();
 
-    midiIntervals.remove(leftNode);
-    midiIntervals.remove(noteInterval);
-
-    leftNode.value.duration += noteInterval.value.duration;
-    leftNode.high = noteInterval.high;
-    leftNode.value.phonemes.append(noteInterval.value.phonemes);
-
-    midiIntervals.insert(leftNode);
+    midiNotes.mergeIntoPrevious(contextMenuNote);
+    contextMenuNote = -1;
+    modified = true;
+    invalidateStaticLayer();
     update();
 };
 
 void F0Widget::toggleCurrentNoteRest() {
-    auto noteInterval = contextMenuNoteInterval;
+    if (contextMenuNote < 0 || contextMenuNote >= midiNotes.size())
+        return;
 
-    midiIntervals.remove(noteInterval);
-    noteInterval.value.isRest = !noteInterval.value.isRest;
-    midiIntervals.insert(noteInterval);
+    midiNotes.setRest(contextMenuNote, !midiNotes.isRest(contextMenuNote));
+    modified = true;
+    invalidateStaticLayer();
     update();
 }
 
@@ -588,50 +601,185 @@ void F0Widget::setCurrentNoteGlideType(QAction *action) {
     else {
         style = GlideStyle::None;
     }
-    auto noteInterval = contextMenuNoteInterval;
-    midiIntervals.remove(noteInterval);
-    noteInterval.value.glide = style;
-    midiIntervals.insert(noteInterval);
+    if (contextMenuNote < 0 || contextMenuNote >= midiNotes.size())
+        return;
+
+    midiNotes.setGlide(contextMenuNote, style);
+    modified = true;
+    invalidateStaticLayer();
     update();
 }
 
 void F0Widget::paintEvent(QPaintEvent *event) {
     QPainter painter(this);
-    QFontMetrics fm = fontMetrics();
-    int lh = fm.lineSpacing();
 
     do {
-        // Fill dark grey background
-        painter.fillRect(rect(), QColor(40, 40, 40));
-
-        // Convenience references
-        auto w = width(), h = height();
-        const Qt::GlobalColor keyColor[] = {Qt::white, Qt::black, Qt::white, Qt::black, Qt::white, Qt::white,
-                                            Qt::black, Qt::white, Qt::black, Qt::white, Qt::black, Qt::white};
-
         // Print centered red error string if the error flag is set
         if (hasError) {
+            painter.fillRect(rect(), QColor(40, 40, 40));
             painter.setPen(Qt::red);
             painter.drawText(rect(), Qt::AlignCenter, errorStatusText);
             break;
         }
 
-        // Draw time axis and marker axis
-        QLinearGradient grad(0, 0, 0, TimeAxisHeight);
-        grad.setColorAt(0, QColor(40, 40, 40));
-        grad.setColorAt(1, QColor(60, 60, 60));
-        painter.fillRect(0, HorizontalScrollHeight, w, TimeAxisHeight, grad);
+        // Everything that only changes with the data or the view comes from the cached layer; hover, drag,
+        // overlay text and playhead are drawn on top every frame
+        const StaticLayerKey key{size(), devicePixelRatioF(), centerTime, centerPitch, secondWidth, semitoneHeight};
+        if (!staticLayerValid || !(key == staticLayerKey)) {
+            staticLayer = QPixmap(size() * key.devicePixelRatio);
+            staticLayer.setDevicePixelRatio(key.devicePixelRatio);
+            QPainter layerPainter(&staticLayer);
+            layerPainter.setFont(font());
+            paintStaticLayer(layerPainter);
+            staticLayerKey = key;
+            staticLayerValid = true;
+        }
+        painter.drawPixmap(0, 0, staticLayer);
+
+        // Piano roll geometry. Find the lowest drawn key from the center pitch
+        auto h = height() - TimelineHeight;
+        auto w = width() - KeyWidth - ScrollBarWidth;
+        double keyReferenceY = h / 2 - (1 - ::fmod(centerPitch, 1)) * semitoneHeight; // Top of center pitch's key
+        int lowestPitch = ::floor(centerPitch) - ::ceil((h - keyReferenceY) / semitoneHeight);
+        double lowestPitchY = keyReferenceY + (int(centerPitch - lowestPitch) + 0.5) * semitoneHeight;
+        auto leftTime = centerTime - w / 2 / secondWidth, rightTime = centerTime + w / 2 / secondWidth;
 
-        // Draw piano roll. Find the lowest drawn key from the center pitch
         painter.translate(KeyWidth, TimelineHeight);
-        h = height() - TimelineHeight;
-        w = width() - KeyWidth - ScrollBarWidth;
         painter.setClipRect(0, 0, w, h);
 
-        painter.setPen(Qt::black);
+        // Drag box / hover box (Do not coexist)
+        int note = -1;
+        if (dragging) {
+            switch (draggingMode) {
+                case Note: {
+                    auto pos = mapFromGlobal(QCursor::pos());
+                    auto mousePitch = pitchOnWidgetY(pos.y());
+                    auto pen = painter.pen();
+                    pen.setColor(Qt::white);
+                    pen.setStyle(Qt::SolidLine);
+                    pen.setWidth(0);
+                    painter.setPen(pen);
+                    auto noteLeft = (std::get<0>(draggingNoteInterval) - leftTime) * secondWidth,
+                        noteRight = (std::get<1>(draggingNoteInterval) - leftTime) * secondWidth;
+                    painter.drawLine(noteLeft, 0, noteLeft, h);
+                    painter.drawLine(noteRight, 0, noteRight, h);
+                    if (draggingNoteInCents) {
+                        auto dragPitch =
+                            mousePitch - draggingNoteStartPitch + draggingNoteBeginCents * 0.01 + draggingNoteBeginPitch;
+                        auto rec = QRectF(noteLeft, lowestPitchY - (dragPitch - lowestPitch) * semitoneHeight,
+                                        noteRight - noteLeft, semitoneHeight);
+                        painter.fillRect(rec, QColor(255, 255, 255, 60));
+                        painter.drawLine(rec.left(), rec.center().y(), rec.right(), rec.center().y());
+                        painter.drawRect(rec);
+                        painter.drawText(rec.topLeft() + QPointF(0, -3), PitchToNotePlusCentsString(dragPitch));
+                    } else {
+                        auto dragPitch = ::floor(mousePitch + 0.5); // Key center pitch -> key bottom pitch
+                        auto rec = QRectF(noteLeft, lowestPitchY - (dragPitch - lowestPitch) * semitoneHeight,
+                                        noteRight - noteLeft, semitoneHeight);
+                        painter.fillRect(rec, QColor(255, 255, 255, 60));
+                        painter.drawRect(rec);
+                    }
+                    break;
+                }
+
+                case Glide: {
+                    auto pos = mapFromGlobal(QCursor::pos());
+                    auto mousePitch = pitchOnWidgetY(pos.y());
+                    auto noteLeft = (std::get<0>(draggingNoteInterval) - leftTime) * secondWidth,
+                        noteRight = (std::get<1>(draggingNoteInterval) - leftTime) * secondWidth;
+                    auto noteCenter = (noteLeft + noteRight) / 2;
+                    auto pen = painter.pen();
+                    pen.setColor(Qt::white);
+                    pen.setStyle(Qt::SolidLine);
+                    pen.setWidth(0);
+                    painter.setPen(pen);
+                    painter.drawLine(noteCenter,
+                                     lowestPitchY - (draggingNoteBeginPitch - lowestPitch - 0.5) * semitoneHeight,
+                                     noteCenter,
+                                     lowestPitchY - (std::round(mousePitch) - lowestPitch - 0.5) * semitoneHeight);
+                    break;
+                }
+
+                default: break;
+            }
+        } else if (mouseOnNote(mapFromGlobal(QCursor::pos()), &note)) {
+            auto rec =
+                QRectF((midiNotes.begin(note) - leftTime) * secondWidth,
+                       lowestPitchY - (midiNotes.pitch(note) +
+                                       (std::isnan(midiNotes.cents(note)) ? 0 : midiNotes.cents(note)) * 0.01 -
+                                       lowestPitch) *
+                                          semitoneHeight,
+                       midiNotes.duration(note) * secondWidth, semitoneHeight);
+            auto pen = painter.pen();
+            pen.setColor(QColor(255, 255, 255, 128));
+            pen.setStyle(Qt::SolidLine);
+            pen.setWidth(5);
+            painter.setPen(pen);
+            painter.drawRect(rec);
+        }
+
+        painter.translate(-KeyWidth, 0);
+        painter.setClipRect(0, 0, width(), h);
+        w += KeyWidth;
+
+        // Debug text
+        if (showPitchTextOverlay) {
+            auto mousePos = mapFromGlobal(QCursor::pos());
+            auto mousePitch = centerPitch + h / 2 / semitoneHeight - (mousePos.y() - TimelineHeight) / semitoneHeight;
+            painter.setPen(Qt::white);
+            painter.drawText(KeyWidth, TimelineHeight,
+                             QString("CenterPitch %1 (%2)  LowestPitch %3 (%4) MousePitch %5 MousePos (%6, %7)")
+                                 .arg(centerPitch)
+                                 .arg(MidiNoteToNoteName(centerPitch))
+                                 .arg(lowestPitch)
+                                 .arg(MidiNoteToNoteName(lowestPitch))
+                                 .arg(mousePitch)
+                                 .arg(mousePos.x())
+                                 .arg(mousePos.y()));
+        }
+
+        painter.translate(0, -TimelineHeight);
+        painter.setClipRect(0, 0, w, height());
+        h += TimelineHeight;
+
+        // Playhead (playheadPos)
+        painter.setPen(QColor(255, 180, 0));
+        painter.drawLine((playheadPos - leftTime) * secondWidth + KeyWidth, TimelineHeight,
+                         (playheadPos - leftTime) * secondWidth + KeyWidth, h);
+    } while (false);
+
+    painter.end();
+
+    QFrame::paintEvent(event);
+}
+
+void F0Widget::paintStaticLayer(QPainter &painter) {
+    QFontMetrics fm = fontMetrics();
+    int lh = fm.lineSpacing();
+    const Qt::GlobalColor keyColor[] = {Qt::white, Qt::black, Qt::white, Qt::black, Qt::white, Qt::white,
+                                        Qt::black, Qt::white, Qt::black, Qt::white, Qt::black, Qt::white};
+
+    // Fill dark grey background
+    painter.fillRect(rect(), QColor(40, 40, 40));
+
+    // Draw time axis and marker axis
+    QLinearGradient grad(0, 0, 0, TimeAxisHeight);
+    grad.setColorAt(0, QColor(40, 40, 40));
+    grad.setColorAt(1, QColor(60, 60, 60));
+    painter.fillRect(0, HorizontalScrollHeight, width(), TimeAxisHeight, grad);
+
+    do {
+        // Piano roll geometry. Find the lowest drawn key from the center pitch
+        auto h = height() - TimelineHeight;
+        auto w = width() - KeyWidth - ScrollBarWidth;
         double keyReferenceY = h / 2 - (1 - ::fmod(centerPitch, 1)) * semitoneHeight; // Top of center pitch's key
         int lowestPitch = ::floor(centerPitch) - ::ceil((h - keyReferenceY) / semitoneHeight);
         double lowestPitchY = keyReferenceY + (int(centerPitch - lowestPitch) + 0.5) * semitoneHeight;
+        auto leftTime = centerTime - w / 2 / secondWidth, rightTime = centerTime + w / 2 / secondWidth;
+
+        // Draw piano roll
+        painter.translate(KeyWidth, TimelineHeight);
+        painter.setClipRect(0, 0, w, h);
 
         // Grid
         painter.setPen(QColor(80, 80, 80));
@@ -644,34 +792,35 @@ void F0Widget::paintEvent(QPaintEvent *event) {
         }
 
         // Midi notes
-        auto leftTime = centerTime - w / 2 / secondWidth, rightTime = centerTime + w / 2 / secondWidth;
         QVector<QPair<QPointF, QString>> noteDescription;
         QVector<QPair<QPointF, QString>> phonemeTexts;
         static constexpr QColor NoteColors[] = {QColor(106, 164, 234), QColor(60, 113, 219)};
-        auto leftBoundaryIntervals = midiIntervals.findIntervalsContainPoint(leftTime, false);
+        auto leftBoundaryNote = midiNotes.indexAt(leftTime);
         auto deltaLeftTime = 0.0;
-        if (!leftBoundaryIntervals.empty() && !leftBoundaryIntervals.front().value.phonemes.empty())
-            deltaLeftTime = leftBoundaryIntervals.front().value.phonemes.back().duration * secondWidth;
-        for (auto &i : midiIntervals.findOverlappingIntervals({leftTime - deltaLeftTime, rightTime}, false)) {
+        if (leftBoundaryNote >= 0 && midiNotes.phonemeBegin(leftBoundaryNote) < midiNotes.phonemeEnd(leftBoundaryNote))
+            deltaLeftTime = midiNotes.phoneme(midiNotes.phonemeEnd(leftBoundaryNote) - 1).duration * secondWidth;
+        auto visibleNotes = midiNotes.overlapping(leftTime - deltaLeftTime, rightTime);
+        for (int i = visibleNotes.first; i < visibleNotes.second; i++) {
             QString noteDescText;
 
-            if (i.value.pitch == 0)
+            const int pitch = midiNotes.pitch(i);
+            const double cents = std::isnan(midiNotes.cents(i)) ? 0 : midiNotes.cents(i);
+            const bool isSlur = midiNotes.isSlur(i);
+            const GlideStyle glide = midiNotes.glide(i);
+            if (pitch == 0)
                 continue; // Skip rests (pitch 0)
-            auto rec = QRectF(
-                (i.low - leftTime) * secondWidth,
-                lowestPitchY - (i.value.pitch + (std::isnan(i.value.cents) ? 0 : i.value.cents) * 0.01 - lowestPitch) *
-                                   semitoneHeight,
-                i.value.duration * secondWidth, semitoneHeight);
+            auto rec = QRectF((midiNotes.begin(i) - leftTime) * secondWidth,
+                              lowestPitchY - (pitch + cents * 0.01 - lowestPitch) * semitoneHeight,
+                              midiNotes.duration(i) * secondWidth, semitoneHeight);
             if (rec.bottom() < 0 || rec.top() > h)
                 continue;
-            if (!i.value.isRest) {
+            if (!midiNotes.isRest(i)) {
                 painter.setPen(Qt::black);
-                painter.fillRect(rec, NoteColors[i.value.isSlur]);
+                painter.fillRect(rec, NoteColors[isSlur]);
                 painter.drawRect(rec);
                 painter.drawLine(rec.left(), rec.center().y(), rec.right(), rec.center().y());
-                noteDescText += PitchToNotePlusCentsString(i.value.pitch +
-                                            0.01 * (std::isnan(i.value.cents) ? 0 : i.value.cents));
-                if (i.value.glide != GlideStyle::None) {
+                noteDescText += PitchToNotePlusCentsString(pitch + 0.01 * cents);
+                if (glide != GlideStyle::None) {
                     /*
                      * Definitions of glide types which cause the difference
                      * between prepending and appending:
@@ -680,9 +829,9 @@ void F0Widget::paintEvent(QPaintEvent *event) {
                      * 2. Down
                      * The pitch glides down at the end, FROM the main note.
                      */
-                    if (i.value.glide == GlideStyle::Up)
+                    if (glide == GlideStyle::Up)
                         noteDescText.prepend("↗");
-                    if (i.value.glide == GlideStyle::Down)
+                    if (glide == GlideStyle::Down)
                         noteDescText.append("↘");
                 }
                 // Defer the drawing of deviation text to prevent the right side notes overlapping with them
@@ -696,7 +845,7 @@ void F0Widget::paintEvent(QPaintEvent *event) {
                 pen.setWidth(1);
                 painter.setPen(pen);
                 auto brush = painter.brush();
-                auto fillColor = NoteColors[i.value.isSlur];
+                auto fillColor = NoteColors[isSlur];
                 fillColor.setAlphaF(0.35);
                 brush.setColor(fillColor);
                 brush.setStyle(Qt::SolidPattern);
@@ -705,9 +854,9 @@ void F0Widget::paintEvent(QPaintEvent *event) {
                 painter.setBrush(Qt::NoBrush);
             }
             // rec.adjust(NotePadding, NotePadding, -NotePadding, -NotePadding);
-            // painter.drawText(rec, Qt::AlignVCenter | Qt::AlignLeft, i.value.text);
             if (showPhonemeTexts) {
-                for (auto &ph : i.value.phonemes) {
+                for (int k = midiNotes.phonemeBegin(i); k < midiNotes.phonemeEnd(i); k++) {
+                    const auto &ph = midiNotes.phoneme(k);
                     auto phRec = QRectF(
                         (ph.begin - leftTime) * secondWidth,
                         rec.y() + semitoneHeight,
@@ -731,76 +880,6 @@ void F0Widget::paintEvent(QPaintEvent *event) {
             }
         }
 
-        // Drag box / hover box (Do not coexist)
-        MiniNoteInterval note{-1, -1};
-        if (dragging) {
-            switch (draggingMode) {
-                case Note: {
-                    auto pos = mapFromGlobal(QCursor::pos());
-                    auto mousePitch = pitchOnWidgetY(pos.y());
-                    auto pen = painter.pen();
-                    pen.setColor(Qt::white);
-                    pen.setStyle(Qt::SolidLine);
-                    pen.setWidth(0);
-                    painter.setPen(pen);
-                    auto noteLeft = (std::get<0>(draggingNoteInterval) - leftTime) * secondWidth,
-                        noteRight = (std::get<1>(draggingNoteInterval) - leftTime) * secondWidth;
-                    painter.drawLine(noteLeft, 0, noteLeft, h);
-                    painter.drawLine(noteRight, 0, noteRight, h);
-                    if (draggingNoteInCents) {
-                        auto dragPitch =
-                            mousePitch - draggingNoteStartPitch + draggingNoteBeginCents * 0.01 + draggingNoteBeginPitch;
-                        auto rec = QRectF(noteLeft, lowestPitchY - (dragPitch - lowestPitch) * semitoneHeight,
-                                        noteRight - noteLeft, semitoneHeight);
-                        painter.fillRect(rec, QColor(255, 255, 255, 60));
-                        painter.drawLine(rec.left(), rec.center().y(), rec.right(), rec.center().y());
-                        painter.drawRect(rec);
-                        painter.drawText(rec.topLeft() + QPointF(0, -3), PitchToNotePlusCentsString(dragPitch));
-                    } else {
-                        auto dragPitch = ::floor(mousePitch + 0.5); // Key center pitch -> key bottom pitch
-                        auto rec = QRectF(noteLeft, lowestPitchY - (dragPitch - lowestPitch) * semitoneHeight,
-                                        noteRight - noteLeft, semitoneHeight);
-                        painter.fillRect(rec, QColor(255, 255, 255, 60));
-                        painter.drawRect(rec);
-                    }
-                    break;
-                }
-
-                case Glide: {
-                    auto pos = mapFromGlobal(QCursor::pos());
-                    auto mousePitch = pitchOnWidgetY(pos.y());
-                    auto noteLeft = (std::get<0>(draggingNoteInterval) - leftTime) * secondWidth,
-                        noteRight = (std::get<1>(draggingNoteInterval) - leftTime) * secondWidth;
-                    auto noteCenter = (noteLeft + noteRight) / 2;
-                    auto pen = painter.pen();
-                    pen.setColor(Qt::white);
-                    pen.setStyle(Qt::SolidLine);
-                    pen.setWidth(0);
-                    painter.setPen(pen);
-                    painter.drawLine(noteCenter,
-                                     lowestPitchY - (draggingNoteBeginPitch - lowestPitch - 0.5) * semitoneHeight,
-                                     noteCenter,
-                                     lowestPitchY - (std::round(mousePitch) - lowestPitch - 0.5) * semitoneHeight);
-                    break;
-                }
-
-                default: break;
-            }
-        } else if (mouseOnNote(mapFromGlobal(QCursor::pos()), &note)) {
-            auto rec =
-                QRectF((note.low - leftTime) * secondWidth,
-                       lowestPitchY - (note.value.pitch + (std::isnan(note.value.cents) ? 0 : note.value.cents) * 0.01 -
-                                       lowestPitch) *
-                                          semitoneHeight,
-                       note.value.duration * secondWidth, semitoneHeight);
-            auto pen = painter.pen();
-            pen.setColor(QColor(255, 255, 255, 128));
-            pen.setStyle(Qt::SolidLine);
-            pen.setWidth(5);
-            painter.setPen(pen);
-            painter.drawRect(rec);
-        }
-
         // F0 Curve
         if (!f0Values.empty()) {
             // lowestPitchY is the lowest (drawn) key's Top-left y coordinate
@@ -809,12 +888,36 @@ void F0Widget::paintEvent(QPaintEvent *event) {
 
             auto visibleF0 = refF0IndexRange(leftTime, rightTime);
             QPainterPath path;
-            double f0X = (std::get<0>(visibleF0) - leftTime / f0Timestep) * f0Timestep * secondWidth,
-                   f0Ybase = lowestPitchY + lowestPitch * semitoneHeight;
-            path.moveTo(f0X, lowestPitchY - (f0Values[std::get<0>(visibleF0)] - lowestPitch) * semitoneHeight);
-            for (int i = std::get<0>(visibleF0) + 1; i < std::get<1>(visibleF0); i++) {
-                f0X += f0Timestep * secondWidth;
-                path.lineTo(f0X, lowestPitchY - (f0Values[i] - lowestPitch) * semitoneHeight);
+
+            // With several samples per pixel, draw the min/max envelope of the coarsest level that still has at
+            // least one bucket per pixel instead of every sample
+            int level = 0;
+            const double samplesPerPixel = 1 / (f0Timestep * secondWidth);
+            while (level < f0Mipmap.size() && (2 << level) <= samplesPerPixel)
+                level++;
+
+            if (level == 0) {
+                double f0X = (std::get<0>(visibleF0) - leftTime / f0Timestep) * f0Timestep * secondWidth;
+                path.moveTo(f0X, lowestPitchY - (f0Values[std::get<0>(visibleF0)] - lowestPitch) * semitoneHeight);
+                for (int i = std::get<0>(visibleF0) + 1; i < std::get<1>(visibleF0); i++) {
+                    f0X += f0Timestep * secondWidth;
+                    path.lineTo(f0X, lowestPitchY - (f0Values[i] - lowestPitch) * semitoneHeight);
+                }
+            } else {
+                const auto &buckets = f0Mipmap[level - 1];
+                const size_t bucketSize = size_t(2) << (level - 1);
+                const size_t first = std::get<0>(visibleF0) / bucketSize,
+                             last = std::min(std::get<1>(visibleF0) / bucketSize, size_t(buckets.size()) - 1);
+                for (size_t b = first; b <= last; b++) {
+                    auto f0X = ((b + 0.5) * bucketSize * f0Timestep - leftTime) * secondWidth;
+                    auto minY = lowestPitchY - (buckets[b].first - lowestPitch) * semitoneHeight,
+                         maxY = lowestPitchY - (buckets[b].second - lowestPitch) * semitoneHeight;
+                    if (b == first)
+                        path.moveTo(f0X, maxY);
+                    else
+                        path.lineTo(f0X, maxY);
+                    path.lineTo(f0X, minY);
+                }
             }
             painter.setPen(Qt::red);
             painter.drawPath(path);
@@ -835,23 +938,6 @@ void F0Widget::paintEvent(QPaintEvent *event) {
 
         painter.translate(-KeyWidth, 0);
         painter.setClipRect(0, 0, width(), h);
-        w += KeyWidth;
-
-        // Debug text
-        if (showPitchTextOverlay) {
-            auto mousePos = mapFromGlobal(QCursor::pos());
-            auto mousePitch = centerPitch + h / 2 / semitoneHeight - (mousePos.y() - TimelineHeight) / semitoneHeight;
-            painter.setPen(Qt::white);
-            painter.drawText(KeyWidth, TimelineHeight,
-                             QString("CenterPitch %1 (%2)  LowestPitch %3 (%4) MousePitch %5 MousePos (%6, %7)")
-                                 .arg(centerPitch)
-                                 .arg(MidiNoteToNoteName(centerPitch))
-                                 .arg(lowestPitch)
-                                 .arg(MidiNoteToNoteName(lowestPitch))
-                                 .arg(mousePitch)
-                                 .arg(mousePos.x())
-                                 .arg(mousePos.y()));
-        }
 
         // Piano keys
         auto prevfont = painter.font();
@@ -878,19 +964,11 @@ void F0Widget::paintEvent(QPaintEvent *event) {
         } while (lowestPitchY > 0 && lowestPitch <= 108);
         painter.setFont(prevfont);
 
-        painter.translate(0, -TimelineHeight);
-        painter.setClipRect(0, 0, w, height());
-        h += TimelineHeight;
-
-        // Playhead (playheadPos)
-        painter.setPen(QColor(255, 180, 0));
-        painter.drawLine((playheadPos - leftTime) * secondWidth + KeyWidth, TimelineHeight,
-                         (playheadPos - leftTime) * secondWidth + KeyWidth, h);
     } while (false);
+}
 
-    painter.end();
-
-    QFrame::paintEvent(event);
+void F0Widget::invalidateStaticLayer() {
+    staticLayerValid = false;
 }
 
 void F0Widget::resizeEvent(QResizeEvent *event) {
@@ -970,8 +1048,8 @@ void F0Widget::mouseDoubleClickEvent(QMouseEvent *event) {
 void F0Widget::mousePressEvent(QMouseEvent *event) {
     draggingStartPos = event->pos();
     draggingButton = event->button();
-    MiniNoteInterval noteInterval{-1, -1};
-    if (mouseOnNote(event->pos(), &noteInterval) && !noteInterval.value.isRest) {
+    int note = -1;
+    if (mouseOnNote(event->pos(), &note) && !midiNotes.isRest(note)) {
         // You are dragging a note
         switch (selectedDragMode) {
             case Note:
@@ -985,9 +1063,10 @@ void F0Widget::mousePressEvent(QMouseEvent *event) {
 
         // This may be less useful for glide labeling but anyways
         draggingNoteStartPitch = pitchOnWidgetY(event->y());
-        draggingNoteInterval = {noteInterval.low, noteInterval.high};
-        draggingNoteBeginCents = std::isnan(noteInterval.value.cents) ? 0 : noteInterval.value.cents;
-        draggingNoteBeginPitch = noteInterval.value.pitch;
+        draggingNote = note;
+        draggingNoteInterval = {midiNotes.begin(note), midiNotes.end(note)};
+        draggingNoteBeginCents = std::isnan(midiNotes.cents(note)) ? 0 : midiNotes.cents(note);
+        draggingNoteBeginPitch = midiNotes.pitch(note);
     } else
         draggingMode = None;
 }
@@ -1030,8 +1109,7 @@ void F0Widget::mouseReleaseEvent(QMouseEvent *event) {
 
 
 void F0Widget::contextMenuEvent(QContextMenuEvent *event) {
-    MiniNoteInterval noteInterval{-1, -1};
-    if (mouseOnNote(event->pos(), &contextMenuNoteInterval)) {
+    if (mouseOnNote(event->pos(), &contextMenuNote)) {
         // Has to determine whether some actions should be enabled
         setNoteContextMenuEntriesEnabled();
         noteMenu->exec(event->globalPos());
@@ -1,10 +1,12 @@
 
 #pragma once
 
-#include "intervaltree.hpp"
+#include "DsSentenceCache.h"
+#include "NoteStore.h"
 #include "SlurCutterCfg.h"
 #include <QFrame>
 #include <QMenu>
+#include <QPixmap>
 #include <QScrollBar>
 #include <QActionGroup>
 #include <QtWidgets/qactiongroup.h>
@@ -18,6 +20,8 @@ public:
     ~F0Widget();
 
     void setDsSentenceContent(const QJsonObject &content);
+    // Parsed f0 curves are looked up in and added to `cache` (not owned); nullptr parses every time.
+    void setSentenceCache(DsSentenceCache *cache);
     void setErrorStatusText(const QString &text);
     void loadConfig(const SlurCutterCfg &cfg);
     void pullConfig(SlurCutterCfg &cfg) const;
@@ -32,6 +36,8 @@ public:
     };
     ReturnedDsString getSavedDsStrings();
     bool empty();
+    // Whether notes were edited since the sentence was loaded
+    bool isModified() const;
 
 public slots:
     void setPlayheadPos(double pos);
@@ -47,16 +53,11 @@ public:
     static QString PitchToNotePlusCentsString(double pitch);
 
 protected:
-    struct MiniNote;
-    enum class GlideStyle {
-        None,
-        Up,
-        Down,
-    };
+    using GlideStyle = NoteGlide;
 
     // Protected methods
     std::tuple<size_t, size_t> refF0IndexRange(double startTime, double endTime) const;
-    bool mouseOnNote(const QPoint &mousePos, Intervals::Interval<double, MiniNote> *returnNote = nullptr) const;
+    bool mouseOnNote(const QPoint &mousePos, int *returnNote = nullptr) const;
 
     // Convenience methods
     double pitchOnWidgetY(int y) const;
@@ -69,6 +70,10 @@ protected:
     void setDraggedNotePitch(int pitch);
     void setDraggedNoteGlide(GlideStyle style);
 
+    // Rendering
+    void paintStaticLayer(QPainter &painter);
+    void invalidateStaticLayer(); // Call after any change to notes, f0 or display options
+
 protected slots:
     // Data manip (global)
     void modeChanged(bool checked);
@@ -93,31 +98,13 @@ protected:
     void mouseReleaseEvent(QMouseEvent *event) override;
 
     // Stored DS file data
-    struct MiniPhonome {
-        QString ph;
-        double begin;
-        double duration;
-    };
-    struct MiniNote {
-        double duration;
-        int pitch;    // Semitone from A0
-        double cents; // nan if no cent deviation
-        QString text;
-        QVector<MiniPhonome> phonemes;
-        bool isSlur, isRest;
-        GlideStyle glide;
-
-        // Required by IntervalTree
-        bool operator<(const MiniNote &other) const {
-            return duration < other.duration;
-        }
-    };
     bool isEmpty = true;
-    using MiniNoteInterval = Intervals::Interval<double, MiniNote>;
-    Intervals::IntervalTree<double, MiniNote> midiIntervals;
-    Intervals::IntervalTree<double> markerIntervals;
+    bool modified = false;
+    NoteStore midiNotes;
     QVector<double> f0Values;
+    QVector<QVector<std::pair<double, double>>> f0Mipmap; // (min, max) per bucket, see setDsSentenceContent
     double f0Timestep;
+    DsSentenceCache *sentenceCache = nullptr;
 
     // Size constants
     static constexpr int KeyWidth = 60, ScrollBarWidth = 25;
@@ -139,11 +126,27 @@ protected:
     bool hasError;
     QString errorStatusText;
 
+    // Background, grid, notes, f0 and keys rendered once per view; rebuilt on a key change or invalidation
+    struct StaticLayerKey {
+        QSize size;
+        qreal devicePixelRatio;
+        double centerTime, centerPitch, secondWidth, semitoneHeight;
+
+        bool operator==(const StaticLayerKey &other) const {
+            return size == other.size && devicePixelRatio == other.devicePixelRatio &&
+                   centerTime == other.centerTime && centerPitch == other.centerPitch &&
+                   secondWidth == other.secondWidth && semitoneHeight == other.semitoneHeight;
+        }
+    };
+    QPixmap staticLayer;
+    StaticLayerKey staticLayerKey{};
+    bool staticLayerValid = false;
+
     // Data Manipulation State
     QPoint draggingStartPos = {-1, -1};
     Qt::MouseButton draggingButton = Qt::MouseButton::NoButton;
     std::tuple<double, double> draggingNoteInterval;
-    MiniNoteInterval contextMenuNoteInterval;
+    int draggingNote = -1, contextMenuNote = -1;
     enum {
         None,
         Note,
@@ -22,6 +22,7 @@
 // #include "Common/SampleFormat.h"
 
 // #include "MathHelper.h"
+#include "QMFunctionRunnable.h"
 #include "QMSystem.h"
 
 // https://iconduck.com/icons
@@ -38,6 +39,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     notifyTimerId = 0;
     playing = false;
 
+    prefetchPool.setMaxThreadCount(1);
+
     setAcceptDrops(true);
 
     initStyleSheet();
@@ -139,6 +142,14 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
     connect(playerWidget, &PlayWidget::playheadChanged, f0Widget, &F0Widget::setPlayheadPos);
 
+    connect(&saveQueue, &QMSaveQueue::saveFailed, this, [this](const QString &filename, const QString &errorString) {
+        QMessageBox::critical(this, "Save error",
+                              QString("Cannot write %1 (%2).\n\n"
+                                      "The edits are kept in the folder's journal and will be written again\n"
+                                      "with the next save or when the folder is opened again.")
+                                  .arg(QDir::toNativeSeparators(filename), errorString));
+    });
+
     reloadWindowTitle();
     resize(1280, 720);
 
@@ -185,35 +196,60 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         }
 
         f0Widget->loadConfig(cfg);
+        if (cfg.cacheParsedF0) {
+            f0Widget->setSentenceCache(&sentenceCache);
+        }
     }
 }
 
 MainWindow::~MainWindow() {
+    prefetchPool.waitForDone();
     pullEditedMidi();
     if (QMFs::isFileExist(lastFile)) {
         saveFile(lastFile);
     }
+    sentenceCache.save();
 }
 
 void MainWindow::openDirectory(const QString &dirname) {
+    saveQueue.setDirectory(dirname);
     fsModel->setRootPath(dirname);
     treeView->setRootIndex(fsModel->index(dirname));
 }
 
 void MainWindow::openFile(const QString &filename) {
-    QString content;
-
     f0Widget->clear();
+    currentRow = -1;
     sentenceWidget->clear();
+    dsBytes.clear();
+    dsIndex.clear();
     dsContent.clear();
-
-    playerWidget->openFile(filename);
+    dsDirty.clear();
+    dsPrefetching.clear();
+    dsGeneration++;
+
+    // Prefetch the audio of the files around this one in the tree
+    QStringList neighbors;
+    const auto index = fsModel->index(filename);
+    for (const auto &neighbor : {treeView->indexBelow(index), treeView->indexAbove(index)}) {
+        QFileInfo info = fsModel->fileInfo(neighbor);
+        if (neighbor.isValid() && info.isFile())
+            neighbors.append(info.absoluteFilePath());
+    }
+    playerWidget->openFile(filename, neighbors);
 
     QString labFile = audioFileToDsFile(filename);
+    if (cfg.cacheParsedF0) {
+        sentenceCache.save();
+        sentenceCache.open(labFile);
+    }
+    QByteArray queued;
     QFile file(labFile);
-    if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        content = QString::fromUtf8(file.readAll());
-        loadDsContent(content);
+    if (saveQueue.pending(labFile, &queued)) {
+        // Saved a moment ago and not on disk yet
+        loadDsContent(queued);
+    } else if (file.open(QIODevice::ReadOnly)) {
+        loadDsContent(file.readAll());
     } else {
         f0Widget->setErrorStatusText("No DS file can be opened");
     }
@@ -221,29 +257,20 @@ void MainWindow::openFile(const QString &filename) {
     // f0Widget->contentText->setPlainText(content);
 }
 
-bool MainWindow::saveFile(const QString &filename) {
-    QJsonArray docArr;
-    foreach (auto &i, dsContent) {
-        docArr.append(i);
-    }
-    QJsonDocument doc(docArr);
-    auto labFile = audioFileToDsFile(filename);
-    QFile file(labFile);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        file.write(doc.toJson(QJsonDocument::Indented));
-        return true;
-    } else {
-        QMessageBox::critical(this, "Save error",
-                              QString("Cannot open %1 to write!\n\n"
-                                      "File switch was not performed. If you were to address the save problem,\n"
-                                      "later you can switch file again and saving will be attempted again.")
-                                  .arg(file.fileName()));
-        return false;
-    }
+void MainWindow::saveFile(const QString &filename) {
+    // Nothing was edited, keep whatever is on disk
+    if (!dsDirty.contains(true))
+        return;
+
+    // Only edited sentences are serialized again, the rest of the file is copied byte for byte. The write itself
+    // happens in the background; failures are reported by saveQueue.
+    dsBytes = spliceDsSentences(dsBytes, dsIndex, dsContent, dsDirty);
+    dsDirty.fill(false);
+    saveQueue.save(audioFileToDsFile(filename), dsBytes);
 }
 
 void MainWindow::pullEditedMidi() {
-    if (currentRow < 0 || f0Widget->empty())
+    if (currentRow < 0 || f0Widget->empty() || !f0Widget->isModified())
         return;
     auto &currentSentence = dsContent[currentRow];
     auto editedSentence = f0Widget->getSavedDsStrings();
@@ -252,6 +279,7 @@ void MainWindow::pullEditedMidi() {
     currentSentence["note_slur"] = editedSentence.note_slur;
     currentSentence["note_dur"] = editedSentence.note_dur;
     currentSentence["note_glide"] = editedSentence.note_glide;
+    dsDirty[currentRow] = true;
 }
 
 void MainWindow::switchFile(bool next) {
@@ -283,53 +311,31 @@ void MainWindow::switchSentence(bool next) {
     }
 }
 
-void MainWindow::loadDsContent(const QString &content) {
-    // Parse as JSON array
-    QJsonParseError err;
-    QJsonDocument doc = QJsonDocument::fromJson(content.toUtf8(), &err);
-
-    if (err.error != QJsonParseError::NoError || !doc.isArray()) {
-        f0Widget->setErrorStatusText(QString("Failed to parse JSON: %1").arg(err.errorString()));
+void MainWindow::loadDsContent(const QByteArray &content) {
+    QString errorString;
+    if (!indexDsContent(content, dsIndex, errorString)) {
+        dsIndex.clear();
+        f0Widget->setErrorStatusText(QString("Failed to parse JSON: %1").arg(errorString));
         return;
     }
 
-    QJsonArray arr = doc.array();
-    if (arr.size() == 0) {
-        f0Widget->setErrorStatusText("Empty JSON array");
+    if (dsIndex.isEmpty()) {
+        f0Widget->setErrorStatusText("No sentence in DS file");
         return;
     }
 
-    // Import sentences
-    for (auto it = arr.begin(); it != arr.end(); ++it) {
-        QJsonObject obj = it->toObject();
-        if (obj.isEmpty()) {
-            continue;
-        }
-        QString text = obj.value("text").toString();
-        if (text.isEmpty()) {
-            continue;
-        }
-        QString noteDuration = obj.value("note_dur").toString();
-        if (noteDuration.isEmpty()) {
-            continue;
-        }
-        auto noteDur = noteDuration.split(' ', QString::SkipEmptyParts);
-        double offset = obj.value("offset").toDouble(-1);
-        if (offset == -1) {
-            continue;
-        }
+    dsBytes = content;
+    dsContent.resize(dsIndex.size());
+    dsDirty.fill(false, dsIndex.size());
 
-        double dur = 0.0;
-        foreach (QString durStr, noteDur) {
-            dur += durStr.toDouble();
-        }
-
-        auto item = new QListWidgetItem(QString("%1-%2").arg(offset, 0, 'f', 2, QChar('0')).arg(text.replace(' ', "")));
-        item->setData(Qt::UserRole + 1, offset);
-        item->setData(Qt::UserRole + 2, dur);
+    // Import sentences
+    for (const auto &sentence : qAsConst(dsIndex)) {
+        auto text = sentence.text;
+        auto item = new QListWidgetItem(
+            QString("%1-%2").arg(sentence.offset, 0, 'f', 2, QChar('0')).arg(text.replace(' ', "")));
+        item->setData(Qt::UserRole + 1, sentence.offset);
+        item->setData(Qt::UserRole + 2, sentence.duration);
         sentenceWidget->addItem(item);
-
-        dsContent.append(obj);
     }
 
     // Set the initial sentence of the file
@@ -337,8 +343,41 @@ void MainWindow::loadDsContent(const QString &content) {
     fileSwitchDirection = true; // Reset the direction state
 }
 
+bool MainWindow::ensureSentenceParsed(int row, QString &errorString) {
+    if (!dsContent[row].isEmpty())
+        return true;
+    return parseDsSentence(dsBytes, dsIndex[row], dsContent[row], errorString);
+}
+
+void MainWindow::prefetchSentence(int row) {
+    if (row < 0 || row >= dsContent.size() || !dsContent[row].isEmpty() || dsPrefetching.contains(row))
+        return;
+    dsPrefetching.insert(row);
+
+    // The byte array is shared, not copied; the parsed object is handed back on the UI thread.
+    const auto content = dsBytes;
+    const auto sentence = dsIndex[row];
+    const int generation = dsGeneration;
+    prefetchPool.start(new QMFunctionRunnable([this, content, sentence, row, generation]() {
+        QJsonObject object;
+        QString errorString;
+        // A failure is reported when the sentence is selected; the row is released either way.
+        const bool parsed = parseDsSentence(content, sentence, object, errorString);
+        QMetaObject::invokeMethod(
+            this,
+            [this, object, parsed, row, generation]() {
+                if (generation != dsGeneration)
+                    return;
+                dsPrefetching.remove(row);
+                if (parsed && dsContent[row].isEmpty())
+                    dsContent[row] = object;
+            },
+            Qt::QueuedConnection);
+    }));
+}
+
 void MainWindow::reloadDsSentenceRequested() {
-    if (currentRow >= 0)
+    if (currentRow >= 0 && !dsContent[currentRow].isEmpty())
         f0Widget->setDsSentenceContent(dsContent[currentRow]);
 }
 
@@ -462,9 +501,7 @@ void MainWindow::_q_treeCurrentChanged(const QModelIndex &current, const QModelI
     QFileInfo info = fsModel->fileInfo(current);
     if (info.isFile()) {
         if (QMFs::isFileExist(lastFile)) {
-            if (!saveFile(lastFile)) {
-                return;
-            }
+            saveFile(lastFile);
         }
         lastFile = info.absoluteFilePath();
         openFile(lastFile);
@@ -477,7 +514,15 @@ void MainWindow::_q_sentenceChanged(int currentRow) {
         return;
     pullEditedMidi();
     this->currentRow = currentRow;
-    f0Widget->setDsSentenceContent(dsContent[currentRow]);
+    QString errorString;
+    if (ensureSentenceParsed(currentRow, errorString)) {
+        f0Widget->setDsSentenceContent(dsContent[currentRow]);
+    } else {
+        f0Widget->clear();
+        f0Widget->setErrorStatusText(errorString);
+    }
+    prefetchSentence(currentRow + 1);
+    prefetchSentence(currentRow - 1);
     auto item = sentenceWidget->item(currentRow);
     double offset = item->data(Qt::UserRole + 1).toDouble(), dur = item->data(Qt::UserRole + 2).toDouble();
     playerWidget->setRange(offset, offset + dur);
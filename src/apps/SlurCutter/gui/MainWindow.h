@@ -14,7 +14,10 @@
 #include <QSplitter>
 #include <QTreeWidget>
 #include <QListWidget>
+#include <QThreadPool>
 
+#include "DsIndex.h"
+#include "QMSaveQueue.h"
 #include "PlayWidget.h"
 #include "F0Widget.h"
 
@@ -63,22 +66,34 @@ protected:
     bool fileSwitchDirection = true; // true = next, false = prev
 
     // Cached DS file content
-    // We only store DS's first layer of objects, anything else is parsed on the fly
+    // The file is only indexed on open; a sentence is parsed when it is first selected, and its neighbors are
+    // prefetched in the background. dsContent holds an empty object until a sentence is parsed. Saving splices
+    // only the sentences flagged in dsDirty back into dsBytes.
+    QByteArray dsBytes;
+    QVector<DsSentenceIndex> dsIndex;
     QVector<QJsonObject> dsContent;
+    QVector<bool> dsDirty;
+    QSet<int> dsPrefetching;
+    int dsGeneration = 0; // bumped per opened file, so late prefetches of the previous file are dropped
+    QThreadPool prefetchPool;
     int currentRow = -1;
+    DsSentenceCache sentenceCache;
+    QMSaveQueue saveQueue;
 
     // Cached application configuration
     SlurCutterCfg cfg;
 
     void openDirectory(const QString &dirname);
     void openFile(const QString &filename);
-    bool saveFile(const QString &filename);
+    void saveFile(const QString &filename);
 
     void pullEditedMidi();
     void switchFile(bool next);
     void switchSentence(bool next);
 
-    void loadDsContent(const QString &content);
+    void loadDsContent(const QByteArray &content);
+    bool ensureSentenceParsed(int row, QString &errorString);
+    void prefetchSentence(int row);
     Q_SLOT void reloadDsSentenceRequested();
 
     void reloadWindowTitle();
@@ -0,0 +1,87 @@
+#include "NoteStore.h"
+
+#include <algorithm>
+
+void NoteStore::clear() {
+    m_begin = {0.0};
+    m_pitch.clear();
+    m_cents.clear();
+    m_flags.clear();
+    m_glide.clear();
+    m_phonemeBegin = {0};
+    m_phonemes.clear();
+}
+
+void NoteStore::reserve(int notes, int phonemes) {
+    m_begin.reserve(notes + 1);
+    m_pitch.reserve(notes);
+    m_cents.reserve(notes);
+    m_flags.reserve(notes);
+    m_glide.reserve(notes);
+    m_phonemeBegin.reserve(notes + 1);
+    m_phonemes.reserve(phonemes);
+}
+
+void NoteStore::append(double duration, int pitch, double cents, bool isSlur, bool isRest, NoteGlide glide) {
+    m_begin.append(m_begin.last() + duration);
+    m_pitch.append(pitch);
+    m_cents.append(cents);
+    m_flags.append((isSlur ? Slur : 0) | (isRest ? Rest : 0));
+    m_glide.append(glide);
+    m_phonemeBegin.append(m_phonemeBegin.last());
+}
+
+void NoteStore::appendPhoneme(const NotePhoneme &phoneme) {
+    m_phonemes.append(phoneme);
+    m_phonemeBegin.last()++;
+}
+
+void NoteStore::setPitch(int i, int pitch, double cents) {
+    m_pitch[i] = pitch;
+    m_cents[i] = cents;
+}
+
+void NoteStore::setRest(int i, bool isRest) {
+    m_flags[i] = isRest ? (m_flags[i] | Rest) : (m_flags[i] & ~Rest);
+}
+
+void NoteStore::setGlide(int i, NoteGlide glide) {
+    m_glide[i] = glide;
+}
+
+int NoteStore::indexAt(double time) const {
+    if (empty() || time < m_begin.first() || time >= m_begin.last())
+        return -1;
+    return int(std::upper_bound(m_begin.begin(), m_begin.end(), time) - m_begin.begin()) - 1;
+}
+
+std::pair<int, int> NoteStore::overlapping(double from, double to) const {
+    // First note whose end is not before from, and first note beginning after to
+    const auto first = std::lower_bound(m_begin.begin() + 1, m_begin.end(), from) - (m_begin.begin() + 1);
+    const auto last = std::upper_bound(m_begin.begin(), m_begin.end() - 1, to) - m_begin.begin();
+    return {int(first), std::max(int(first), int(last))};
+}
+
+int NoteStore::split(int i, double time) {
+    const auto phonemeSplit =
+        std::lower_bound(m_phonemes.begin() + m_phonemeBegin[i], m_phonemes.begin() + m_phonemeBegin[i + 1], time,
+                         [](const NotePhoneme &ph, double t) { return ph.begin < t; }) -
+        m_phonemes.begin();
+
+    m_begin.insert(i + 1, time);
+    m_pitch.insert(i + 1, m_pitch[i]);
+    m_cents.insert(i + 1, m_cents[i]);
+    m_flags.insert(i + 1, m_flags[i] | Slur);
+    m_glide.insert(i + 1, m_glide[i]);
+    m_phonemeBegin.insert(i + 1, int(phonemeSplit));
+    return i + 1;
+}
+
+void NoteStore::mergeIntoPrevious(int i) {
+    m_begin.remove(i);
+    m_pitch.remove(i);
+    m_cents.remove(i);
+    m_flags.remove(i);
+    m_glide.remove(i);
+    m_phonemeBegin.remove(i);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include <utility>
+
+enum class NoteGlide {
+    None,
+    Up,
+    Down,
+};
+
+struct NotePhoneme {
+    QString ph;
+    double begin;
+    double duration;
+};
+
+// The notes of one sentence. Notes are contiguous and never overlap, so they are kept as parallel arrays sorted by
+// time and looked up by binary search. Note i spans [begin(i), begin(i + 1)); its phonemes are the slice
+// [phonemeBegin(i), phonemeEnd(i)) of one shared, time ordered phoneme pool, so splitting or merging notes only
+// moves a slice boundary.
+class NoteStore {
+public:
+    void clear();
+    void reserve(int notes, int phonemes);
+
+    int size() const {
+        return m_pitch.size();
+    }
+    bool empty() const {
+        return m_pitch.isEmpty();
+    }
+
+    // Appends a note starting where the last one ends. Phonemes appended afterwards belong to it.
+    void append(double duration, int pitch, double cents, bool isSlur, bool isRest, NoteGlide glide);
+    void appendPhoneme(const NotePhoneme &phoneme);
+
+    double begin(int i) const {
+        return m_begin[i];
+    }
+    double end(int i) const {
+        return m_begin[i + 1];
+    }
+    double duration(int i) const {
+        return m_begin[i + 1] - m_begin[i];
+    }
+    int pitch(int i) const {
+        return m_pitch[i];
+    }
+    double cents(int i) const {
+        return m_cents[i]; // nan if no cent deviation
+    }
+    bool isSlur(int i) const {
+        return m_flags[i] & Slur;
+    }
+    bool isRest(int i) const {
+        return m_flags[i] & Rest;
+    }
+    NoteGlide glide(int i) const {
+        return m_glide[i];
+    }
+
+    int phonemeBegin(int i) const {
+        return m_phonemeBegin[i];
+    }
+    int phonemeEnd(int i) const {
+        return m_phonemeBegin[i + 1];
+    }
+    const NotePhoneme &phoneme(int k) const {
+        return m_phonemes[k];
+    }
+
+    void setPitch(int i, int pitch, double cents);
+    void setRest(int i, bool isRest);
+    void setGlide(int i, NoteGlide glide);
+
+    // Index of the note containing time, or -1 outside the sentence.
+    int indexAt(double time) const;
+    // Notes [first, last) overlapping [from, to]; notes that only touch the range are included.
+    std::pair<int, int> overlapping(double from, double to) const;
+
+    // Splits note i at time (inside it). The right half becomes a slur and takes the phonemes starting at or after
+    // time. Returns the index of the right half.
+    int split(int i, double time);
+    // Appends note i to note i - 1 and removes it.
+    void mergeIntoPrevious(int i);
+
+private:
+    enum Flag : quint8 {
+        Slur = 1,
+        Rest = 2,
+    };
+
+    // m_begin and m_phonemeBegin hold one extra trailing entry: the sentence end and the phoneme count.
+    QVector<double> m_begin{0.0};
+    QVector<int> m_pitch;
+    QVector<double> m_cents;
+    QVector<quint8> m_flags;
+    QVector<NoteGlide> m_glide;
+    QVector<int> m_phonemeBegin{0};
+    QVector<NotePhoneme> m_phonemes;
+};
@@ -0,0 +1,230 @@
+#include "PcmCache.h"
+
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstring>
+
+#include "FFmpegDecoder.h"
+#include "QMFunctionRunnable.h"
+
+namespace {
+    bool decodeFile(const QString &filename, const QsMedia::WaveArguments &args, const QAtomicInt &canceled,
+                    DecodedPcm &pcm) {
+        // Only float playback is served from the cache
+        if (args.sampleFormat != QsMedia::AV_SAMPLE_FMT_FLT)
+            return false;
+
+        FFmpegDecoder decoder;
+        if (!decoder.open(filename, {args.sampleRate, QsMedia::AV_SAMPLE_FMT_S16, args.channels}) ||
+            decoder.Length() > PcmCache::MaxFileBytes)
+            return false;
+
+        const auto format = decoder.Format();
+        pcm.format = NAudio::WaveFormat::CreateIeeeFloatWaveFormat(format.SampleRate(), format.Channels());
+        pcm.inFormat = decoder.inFormat();
+        // Length is estimated from the container, so keep reading until the decoder runs dry
+        QByteArray data(decoder.Length(), Qt::Uninitialized);
+        qint64 size = 0;
+        while (true) {
+            if (canceled.loadAcquire())
+                return false;
+            if (size == data.size()) {
+                if (size >= PcmCache::MaxFileBytes)
+                    return false;
+                data.resize(size + 65536);
+            }
+            const int chunk = int(std::min<qint64>(data.size() - size, 1 << 20));
+            const int read = decoder.Read(data.data() + size, 0, chunk);
+            if (read <= 0)
+                break;
+            size += read;
+        }
+        size -= size % format.BlockAlign();
+        pcm.samples.resize(int(size / qint64(sizeof(qint16))));
+        std::memcpy(pcm.samples.data(), data.constData(), size);
+        return true;
+    }
+}
+
+PcmCache::PcmCache(const QsMedia::WaveArguments &args, QObject *parent) : QObject(parent), args(args) {
+    pool.setMaxThreadCount(2);
+}
+
+PcmCache::~PcmCache() {
+    for (const auto &canceled : qAsConst(decoding))
+        canceled->storeRelease(1);
+    pool.clear();
+    pool.waitForDone();
+}
+
+void PcmCache::retain(const QStringList &filenames) {
+    wanted = filenames;
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        if (wanted.contains(it.key())) {
+            ++it;
+        } else {
+            bytes -= it.value()->bytes();
+            it = buffers.erase(it);
+        }
+    }
+    // Decodes queued for files stepped past would hold up the one about to be played
+    for (auto it = decoding.constBegin(); it != decoding.constEnd(); ++it) {
+        if (!wanted.contains(it.key()))
+            it.value()->storeRelease(1);
+    }
+
+    // A cancelled decode still running for a wanted file is restarted once it has returned
+    for (int i = 0; i < filenames.size(); ++i) {
+        const auto &filename = filenames[i];
+        if (!buffers.contains(filename) && !decoding.contains(filename))
+            decode(filename, filenames.size() - i);
+    }
+}
+
+void PcmCache::decode(const QString &filename, int priority) {
+    const auto canceled = QSharedPointer<QAtomicInt>::create(0);
+    decoding.insert(filename, canceled);
+    const auto args = this->args;
+    pool.start(new QMFunctionRunnable([this, filename, args, canceled]() {
+        auto pcm = QSharedPointer<DecodedPcm>::create();
+        const bool ok = !canceled->loadAcquire() && decodeFile(filename, args, *canceled, *pcm);
+        QMetaObject::invokeMethod(
+            this,
+            [this, filename, ok, pcm, canceled]() {
+                decoding.remove(filename);
+                const int rank = wanted.indexOf(filename);
+                if (rank < 0)
+                    return;
+                if (!ok) {
+                    if (canceled->loadAcquire())
+                        decode(filename, 0);
+                    return;
+                }
+                const qint64 size = pcm->bytes();
+                for (int i = wanted.size() - 1; i > rank && bytes + size > MaxBytes; --i) {
+                    if (const auto dropped = buffers.take(wanted[i]))
+                        bytes -= dropped->bytes();
+                }
+                if (bytes + size > MaxBytes)
+                    return;
+                buffers.insert(filename, pcm);
+                bytes += size;
+                emit decoded(filename);
+            },
+            Qt::QueuedConnection);
+    }), priority);
+}
+
+QSharedPointer<const DecodedPcm> PcmCache::get(const QString &filename) const {
+    return buffers.value(filename);
+}
+
+CachedAudioDecoder::CachedAudioDecoder(const PcmCache *cache, QObject *parent)
+    : IAudioDecoder(parent), cache(cache), fallback(new FFmpegDecoder(this)) {
+}
+
+CachedAudioDecoder::~CachedAudioDecoder() {
+    CachedAudioDecoder::close();
+}
+
+bool CachedAudioDecoder::open(const QString &filename, const QsMedia::WaveArguments &args) {
+    close();
+
+    QMutexLocker locker(&mutex);
+    this->filename = filename;
+    pos = 0;
+    if ((pcm = cache->get(filename)))
+        return true;
+    return fallback->open(filename, args);
+}
+
+void CachedAudioDecoder::close() {
+    QMutexLocker locker(&mutex);
+    pcm.reset();
+    pos = 0;
+    filename.clear();
+    if (fallback->isOpen())
+        fallback->close();
+}
+
+bool CachedAudioDecoder::isOpen() const {
+    QMutexLocker locker(&mutex);
+    return pcm || fallback->isOpen();
+}
+
+NAudio::WaveFormat CachedAudioDecoder::inFormat() const {
+    QMutexLocker locker(&mutex);
+    return pcm ? pcm->inFormat : fallback->inFormat();
+}
+
+bool CachedAudioDecoder::useCache() {
+    QMutexLocker locker(&mutex);
+    if (pcm)
+        return true;
+    auto cached = cache->get(filename);
+    if (!cached || !fallback->isOpen())
+        return false;
+    const int align = cached->format.BlockAlign();
+    const qint64 position = fallback->Position();
+    pos = std::min<qint64>(position - position % align, cached->length());
+    pcm = cached;
+    fallback->close();
+    return true;
+}
+
+NAudio::WaveFormat CachedAudioDecoder::Format() const {
+    QMutexLocker locker(&mutex);
+    return pcm ? pcm->format : fallback->Format();
+}
+
+void CachedAudioDecoder::SetPosition(qint64 pos) {
+    QMutexLocker locker(&mutex);
+    if (!pcm) {
+        fallback->SetPosition(pos);
+        return;
+    }
+    const int align = pcm->format.BlockAlign();
+    this->pos = std::clamp<qint64>(pos - pos % align, 0, pcm->length());
+}
+
+qint64 CachedAudioDecoder::Position() const {
+    QMutexLocker locker(&mutex);
+    return pcm ? pos : fallback->Position();
+}
+
+qint64 CachedAudioDecoder::Length() const {
+    QMutexLocker locker(&mutex);
+    return pcm ? pcm->length() : fallback->Length();
+}
+
+int CachedAudioDecoder::Read(char *buffer, int offset, int count) {
+    QMutexLocker locker(&mutex);
+    if (!pcm)
+        return fallback->Read(buffer, offset, count);
+    return readPcm(buffer, offset, count);
+}
+
+int CachedAudioDecoder::Read(float *buffer, int offset, int count) {
+    QMutexLocker locker(&mutex);
+    if (!pcm)
+        return fallback->Read(buffer, offset, count);
+    const int bytesPerSample = sizeof(float);
+    return readPcm(reinterpret_cast<char *>(buffer), offset * bytesPerSample, count * bytesPerSample) /
+           bytesPerSample;
+}
+
+int CachedAudioDecoder::readPcm(char *buffer, int offset, int count) {
+    // Same contract as the FFmpeg decoder: skip offset bytes, then fill buffer from its start
+    const int bytesPerSample = sizeof(float);
+    pos = std::min<qint64>(pos + offset, pcm->length());
+    pos -= pos % bytesPerSample;
+    const int n = int(std::min<qint64>(count, pcm->length() - pos)) / bytesPerSample;
+    const qint16 *in = pcm->samples.constData() + pos / bytesPerSample;
+    for (int i = 0; i < n; ++i) {
+        const float sample = in[i] / 32768.0f;
+        std::memcpy(buffer + i * bytesPerSample, &sample, bytesPerSample);
+    }
+    pos += n * bytesPerSample;
+    return n * bytesPerSample;
+}
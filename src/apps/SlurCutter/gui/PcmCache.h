@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "Api/IAudioDecoder.h"
+
+// Fully decoded audio of one file at the playback rate and channels. Samples are kept as 16-bit, half the size of
+// the float playback format they are converted to while reading.
+struct DecodedPcm {
+    QVector<qint16> samples;
+    NAudio::WaveFormat format, inFormat;
+
+    // Size in the playback format
+    qint64 length() const {
+        return qint64(samples.size()) * qint64(sizeof(float));
+    }
+    // Memory taken by the samples
+    qint64 bytes() const {
+        return qint64(samples.size()) * qint64(sizeof(qint16));
+    }
+};
+
+// Decoded audio of the file being edited and its neighbors. Files are decoded on a background pool as soon as they
+// are retained, so playing any sentence of them starts without opening, seeking or resampling anything.
+class PcmCache : public QObject {
+    Q_OBJECT
+public:
+    explicit PcmCache(const QsMedia::WaveArguments &args, QObject *parent = nullptr);
+    ~PcmCache();
+
+    // Keeps exactly these files, decoding the missing ones first to last; anything else is dropped and its pending
+    // decode cancelled.
+    void retain(const QStringList &filenames);
+    // Null until the file is decoded.
+    QSharedPointer<const DecodedPcm> get(const QString &filename) const;
+
+    // About 6 minutes of 44.1 kHz stereo per file, so a whole song fits. Larger files are played from the decoder
+    // directly; when the budget for all files runs out, the last retained files are dropped first.
+    static constexpr qint64 MaxFileBytes = 64 << 20;
+    static constexpr qint64 MaxBytes = 3 * MaxFileBytes;
+
+signals:
+    void decoded(const QString &filename);
+
+private:
+    void decode(const QString &filename, int priority);
+
+    QsMedia::WaveArguments args;
+    QThreadPool pool;
+    QHash<QString, QSharedPointer<const DecodedPcm>> buffers;
+    qint64 bytes = 0;
+    QHash<QString, QSharedPointer<QAtomicInt>> decoding; // Set to cancel the decode
+    QStringList wanted; // by priority
+};
+
+// Decoder handed to the playback. It reads from PcmCache when the file is decoded there and from an FFmpegDecoder
+// otherwise; useCache() switches an open file over once its PCM arrives.
+class CachedAudioDecoder : public QsApi::IAudioDecoder {
+    Q_OBJECT
+public:
+    explicit CachedAudioDecoder(const PcmCache *cache, QObject *parent = nullptr);
+    ~CachedAudioDecoder();
+
+    bool open(const QString &filename, const QsMedia::WaveArguments &args = {}) override;
+    void close() override;
+    bool isOpen() const override;
+    NAudio::WaveFormat inFormat() const override;
+
+    // Serves the open file from the cache from now on, keeping the position. Returns false if it is not cached.
+    bool useCache();
+
+public:
+    NAudio::WaveFormat Format() const override;
+
+    void SetPosition(qint64 pos) override;
+    qint64 Position() const override;
+    qint64 Length() const override;
+
+    int Read(char *buffer, int offset, int count) override;
+    int Read(float *buffer, int offset, int count) override;
+
+private:
+    int readPcm(char *buffer, int offset, int count);
+
+    const PcmCache *cache;
+    QsApi::IAudioDecoder *fallback;
+    QString filename;
+    QSharedPointer<const DecodedPcm> pcm;
+    qint64 pos = 0;
+    mutable QMutex mutex; // Read runs on the playback thread
+};
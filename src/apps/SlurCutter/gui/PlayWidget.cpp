@@ -132,6 +132,7 @@ PlayWidget::PlayWidget(QWidget *parent) : QWidget(parent) {
     connect(playback, &QsApi::IAudioPlayback::deviceChanged, this, &PlayWidget::_q_audioDeviceChanged);
     connect(playback, &QsApi::IAudioPlayback::deviceAdded, this, &PlayWidget::_q_audioDeviceAdded);
     connect(playback, &QsApi::IAudioPlayback::deviceRemoved, this, &PlayWidget::_q_audioDeviceRemoved);
+    connect(pcmCache, &PcmCache::decoded, this, &PlayWidget::_q_pcmDecoded);
 
     reloadDevices();
     reloadButtonStatus();
@@ -143,8 +144,11 @@ PlayWidget::~PlayWidget() {
     uninitPlugins();
 }
 
-void PlayWidget::openFile(const QString &filename) {
+void PlayWidget::openFile(const QString &filename, const QStringList &neighbors) {
     setPlaying(false);
+    // Before opening, so a file that is already decoded is played from memory
+    pcmCache->retain(QStringList{filename} + neighbors);
+
     if (decoder->isOpen()) {
         decoder->SetPosition(0);
         reloadSliderStatus();
@@ -189,6 +193,8 @@ void PlayWidget::setPlaying(bool playing) {
     } else {
         playback->stop();
         pauseAtTime = estimatedTimeMs();
+        // The playback thread is done with the decoder, a file decoded while playing can be served from memory now
+        decoder->useCache();
         killTimer(notifyTimerId);
         notifyTimerId = 0;
     }
@@ -220,7 +226,6 @@ void PlayWidget::timerEvent(QTimerEvent *event) {
     }
 }
 
-#include "FFmpegDecoder.h"
 #include "SDLPlayback.h"
 
 void PlayWidget::initPlugins() {
@@ -257,7 +262,8 @@ void PlayWidget::initPlugins() {
     //     goto out2;
     // }
 
-    decoder = new FFmpegDecoder();
+    pcmCache = new PcmCache({44100, QsMedia::AV_SAMPLE_FMT_FLT, 2}, this);
+    decoder = new CachedAudioDecoder(pcmCache);
     playback = new SDLPlayback();
 
     if (!playback->setup(QsMedia::PlaybackArguments{44100, 2, 1024})) {
@@ -430,3 +436,9 @@ void PlayWidget::_q_audioDeviceAdded() {
 void PlayWidget::_q_audioDeviceRemoved() {
     reloadDevices();
 }
+
+void PlayWidget::_q_pcmDecoded(const QString &filename) {
+    // The playback thread reads the decoder, so only switch it over while stopped; setPlaying(false) does it otherwise
+    if (filename == this->filename && !playing)
+        decoder->useCache();
+}
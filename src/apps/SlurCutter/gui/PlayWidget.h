@@ -19,13 +19,16 @@
 #include "Api/interfaces/IAudioDecoderPlugin.h"
 #include "Api/interfaces/IAudioPlaybackPlugin.h"
 
+#include "PcmCache.h"
+
 class PlayWidget : public QWidget {
     Q_OBJECT
 public:
     PlayWidget(QWidget *parent = nullptr);
     ~PlayWidget();
 
-    void openFile(const QString &filename);
+    // The neighbors are decoded into memory in the background, so switching to them starts playing at once
+    void openFile(const QString &filename, const QStringList &neighbors = {});
 
     bool isPlaying() const;
     void setPlaying(bool playing);
@@ -40,7 +43,8 @@ protected:
 
     // QsApi::IAudioDecoderPlugin *decoder_plugin;
     // QsApi::IAudioPlaybackPlugin *playback_plugin;
-    QsApi::IAudioDecoder *decoder;
+    PcmCache *pcmCache;
+    CachedAudioDecoder *decoder;
     QsApi::IAudioPlayback *playback;
 
     QMenu *deviceMenu;
@@ -91,6 +95,7 @@ private:
     void _q_audioDeviceChanged();
     void _q_audioDeviceAdded();
     void _q_audioDeviceRemoved();
+    void _q_pcmDecoded(const QString &filename);
 };
 
 #endif // PLAYWIDGET_H
@@ -13,7 +13,8 @@ struct SlurCutterCfg {
     bool snapToKeys;
     bool showPitchTextOverlay;
     bool showPhonemeTexts;
+    bool cacheParsedF0; // keep parsed f0 curves in a binary sidecar next to each .ds file
 
-    SlurCutterCfg() : snapToKeys(true), showPitchTextOverlay(false), showPhonemeTexts(true) {}
+    SlurCutterCfg() : snapToKeys(true), showPitchTextOverlay(false), showPhonemeTexts(true), cacheParsedF0(false) {}
 };
 QAS_JSON_NS(SlurCutterCfg);
\ No newline at end of file
@@ -83,13 +83,12 @@ WaveFormat FFmpegDecoder::Format() const {
 void FFmpegDecoder::SetPosition(qint64 pos) {
     Q_D(FFmpegDecoder);
     std::lock_guard locker(d->lockObject);
-    d->_pos = d->dest2src_bytes(pos / d->_arguments.Channels);
-    d->seek();
+    d->seek(pos);
 }
 
 qint64 FFmpegDecoder::Position() const {
     Q_D(const FFmpegDecoder);
-    return d->src2dest_bytes(d->_pos) * d->_arguments.Channels;
+    return d->_readPos;
 }
 
 qint64 FFmpegDecoder::Length() const {
@@ -104,14 +103,14 @@ int FFmpegDecoder::Read(char *buffer, int offset, int count) {
     int res = 0;
 
     if (offset > 0) {
-        int err = d->decode(nullptr, offset);
+        int err = d->read(nullptr, offset);
         if (err < 0) {
             return err;
         }
     }
 
     if (count > 0) {
-        res = d->decode(buffer, count);
+        res = d->read(buffer, count);
     }
 
     return res;
@@ -133,14 +132,14 @@ int FFmpegDecoder::Read(float *buffer, int offset, int count) {
     count *= bytesPerSample;
 
     if (offset > 0) {
-        int err = d->decode(nullptr, offset);
+        int err = d->read(nullptr, offset);
         if (err < 0) {
             return err;
         }
     }
 
     if (count > 0) {
-        res = d->decode((char *) buffer, count);
+        res = d->read((char *) buffer, count);
     }
 
     res /= bytesPerSample;
@@ -24,12 +24,16 @@ void FFmpegDecoderPrivate::clear() {
     _frame = nullptr;
 
     _length = 0;
-    _pos = 0;
     _audioIndex = -1;
-    _remainSamples = 0;
-    _cachedBufferPos = 0;
 
-    _cachedBuffer.clear();
+    _readPos = 0;
+    _seekPos = 0;
+    _dropSamples = -1;
+
+    _seekPending = false;
+    _eof = false;
+    _quit = false;
+    _producer = nullptr;
 }
 
 bool FFmpegDecoderPrivate::initDecoder() {
@@ -114,6 +118,9 @@ bool FFmpegDecoderPrivate::initDecoder() {
                         .arg(QString(av_get_sample_fmt_name(_arguments.SampleFormat)));
     }
 
+    // 输出总是交错存储，重采样结果直接写入同一块缓冲区
+    _arguments.SampleFormat = av_get_packed_sample_fmt(_arguments.SampleFormat);
+
     if (_arguments.Channels < 0) {
         _arguments.Channels = srcChannels > 2 ? 2 : srcChannels;
         qDebug() << QString("FFmpeg: Set default channels as %1")
@@ -172,12 +179,19 @@ bool FFmpegDecoderPrivate::initDecoder() {
     _packet = pkt;
     _frame = frame;
 
+    // 预取约一秒的输出数据
+    _ring.allocate(_arguments.SampleRate * _arguments.Channels * _arguments.BytesPerSample());
+    startProducer();
+
     isOpen = true;
 
     return true;
 }
 
 void FFmpegDecoderPrivate::quitDecoder() {
+    // 先停止预取线程，之后才能释放解码器
+    stopProducer();
+
     auto fmt_ctx = _formatContext;
     auto codec_ctx = _codecContext;
     auto swr_ctx = _swrContext;
@@ -214,202 +228,269 @@ void FFmpegDecoderPrivate::quitDecoder() {
     isOpen = false;
 }
 
-int FFmpegDecoderPrivate::decode(char *buf, int size) {
-    auto fmt_ctx = _formatContext;
-    auto codec_ctx = _codecContext;
-    auto swr_ctx = _swrContext;
+int FFmpegDecoderPrivate::read(char *buf, int size) {
+    // 未打开时没有预取线程，不能等待
+    if (!_producer) {
+        return 0;
+    }
 
-    auto pkt = _packet;
-    auto frame = _frame;
+    int bufferWriteOffset = 0;
 
-    auto stream = fmt_ctx->streams[_audioIndex];
+    // 数据由预取线程准备好，这里只做拷贝；不够时等待，直到读满或文件结束
+    while (bufferWriteOffset < size) {
+        int n = _ring.read(buf ? buf + bufferWriteOffset : nullptr, size - bufferWriteOffset);
+        if (n > 0) {
+            bufferWriteOffset += n;
 
-    // 准备声道信息
-    AVChannelLayout out_ch_layout;
-    int ret = av_channel_layout_copy(&out_ch_layout, &_channelLayout);
-    if (ret < 0) {
-        error_on_channel_copy(-ret);
-        return -1;
+            // 通知预取线程有空位了
+            std::lock_guard lock(ringMutex);
+            ringCond.notify_all();
+            continue;
+        }
+
+        std::unique_lock lock(ringMutex);
+        ringCond.wait(lock, [this]() { return _ring.readable() > 0 || _eof || _quit; });
+        if (_ring.readable() == 0) {
+            break;
+        }
     }
 
-    // 跳过上次重采样器的余量
-    int remained = 0;
-    if (_remainSamples > 0) {
-        // 获取采样数
-        remained = (int) av_rescale_rnd(_remainSamples, _arguments.SampleRate,
-                                        _waveFormat.SampleRate(), AV_ROUND_UP);
-        // 获取字节数
-        remained = remained == 0 ? 0
-                                 : av_samples_get_buffer_size(nullptr, _channelLayout.nb_channels,
-                                                              remained, _arguments.SampleFormat, 1);
+    _readPos += bufferWriteOffset;
 
-        _remainSamples = 0;
+    if (bufferWriteOffset < size) {
+        // 标记为最终时间
+        _readPos = src2dest_bytes(_length) * _arguments.Channels;
     }
 
-    int bufferWriteOffset = 0;
+    return bufferWriteOffset;
+}
 
-    // 采取边解码边写到输出缓冲区的方式。策略是先把cache全部写出，然后边解码边写，写到最后剩下的再存入cache
-    auto cacheTransferSize = std::min(int(_cachedBuffer.size()) - _cachedBufferPos, size);
-    if (cacheTransferSize > 0) {
-        ::memcpy(buf, _cachedBuffer.data() + _cachedBufferPos, cacheTransferSize);
-        _cachedBufferPos += cacheTransferSize;
-        bufferWriteOffset = cacheTransferSize;
+void FFmpegDecoderPrivate::seek(qint64 pos) {
+    if (!_producer) {
+        return;
     }
 
-    while (bufferWriteOffset < size) {
-        int ret = av_read_frame(fmt_ctx, pkt);
+    std::unique_lock lock(ringMutex);
 
-        // 判断是否结束
-        if (ret == AVERROR_EOF) {
-            //标记为最终时间
-            _pos = _length;
+    // 对齐到采样
+    const int blockAlign = _arguments.Channels * _arguments.BytesPerSample();
+    pos -= pos % blockAlign;
 
-            av_packet_unref(pkt);
+    // 交给预取线程执行，等它清空缓冲区并完成跳转
+    _seekPos = pos;
+    _seekPending = true;
+    ringCond.notify_all();
+    ringCond.wait(lock, [this]() { return !_seekPending || _quit; });
+
+    _readPos = pos;
+}
+
+void FFmpegDecoderPrivate::startProducer() {
+    _quit = false;
+    _producer = new std::thread(&FFmpegDecoderPrivate::produce, this);
+}
+
+void FFmpegDecoderPrivate::stopProducer() {
+    if (!_producer) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(ringMutex);
+        _quit = true;
+        ringCond.notify_all();
+    }
+    _producer->join();
+
+    delete _producer;
+    _producer = nullptr;
+}
+
+void FFmpegDecoderPrivate::produce() {
+    std::unique_lock lock(ringMutex);
+    while (true) {
+        ringCond.wait(lock, [this]() { return _quit || _seekPending || (!_eof && _ring.writable() > 0); });
+        if (_quit) {
             break;
-        } else if (ret != 0) {
-            // 忽略
-            qDebug() << QString("FFmpeg: Error getting next frame with code %1, ignored")
-                            .arg(QString::number(-ret));
-            continue;
         }
 
-        // 跳过其他流
-        if (pkt->stream_index != _audioIndex) {
-            av_packet_unref(pkt);
+        if (_seekPending) {
+            lock.unlock();
+            doSeek();
+            lock.lock();
+
+            _seekPending = false;
+            _eof = false;
+            ringCond.notify_all();
             continue;
         }
 
-        // 发送待解码包
-        ret = avcodec_send_packet(codec_ctx, pkt);
-        av_packet_unref(pkt);
+        lock.unlock();
+        int ret = decodePacket();
+        lock.lock();
+
         if (ret < 0) {
+            _eof = true;
+            ringCond.notify_all();
+        }
+    }
+}
+
+int FFmpegDecoderPrivate::decodePacket() {
+    auto fmt_ctx = _formatContext;
+    auto codec_ctx = _codecContext;
+    auto swr_ctx = _swrContext;
+
+    auto pkt = _packet;
+    auto frame = _frame;
+
+    auto stream = fmt_ctx->streams[_audioIndex];
+
+    int ret = av_read_frame(fmt_ctx, pkt);
+
+    // 判断是否结束
+    if (ret == AVERROR_EOF) {
+        av_packet_unref(pkt);
+        return AVERROR_EOF;
+    } else if (ret != 0) {
+        // 忽略
+        qDebug() << QString("FFmpeg: Error getting next frame with code %1, ignored")
+                        .arg(QString::number(-ret));
+        return 0;
+    }
+
+    // 跳过其他流
+    if (pkt->stream_index != _audioIndex) {
+        av_packet_unref(pkt);
+        return 0;
+    }
+
+    // 发送待解码包
+    ret = avcodec_send_packet(codec_ctx, pkt);
+    av_packet_unref(pkt);
+    if (ret < 0) {
+        // 忽略
+        qDebug() << QString("FFmpeg: Error submitting a packet for decoding with code %1, ignored")
+                        .arg(QString::number(-ret));
+        return 0;
+    }
+
+    const int blockAlign = _arguments.Channels * _arguments.BytesPerSample();
+
+    while (ret >= 0) {
+        // 接收解码数据
+        ret = avcodec_receive_frame(codec_ctx, frame);
+        if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN)) {
+            // 结束
+            break;
+        } else if (ret < 0) {
+            // 出错
+            av_frame_unref(frame);
+
             // 忽略
-            qDebug() << QString(
-                            "FFmpeg: Error submitting a packet for decoding with code %1, ignored")
+            qDebug() << QString("FFmpeg: Error decoding frame with code %1, ignored")
                             .arg(QString::number(-ret));
             continue;
         }
 
-        while (ret >= 0) {
-            // 接收解码数据
-            ret = avcodec_receive_frame(codec_ctx, frame);
-            if (ret == AVERROR_EOF || ret == AVERROR(EAGAIN)) {
-                // 结束
-                break;
-            } else if (ret < 0) {
-                // 出错
-                av_frame_unref(frame);
-
-                // 忽略
-                qDebug() << QString("FFmpeg: Error decoding frame with code %1, ignored")
-                                .arg(QString::number(-ret));
-                continue;
+        // 跳转后的第一帧：让重采样器丢弃目标位置之前的采样，使读取位置精确到采样
+        if (_dropSamples >= 0) {
+            if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+                qint64 frameStart = av_rescale_q(frame->best_effort_timestamp, stream->time_base,
+                                                 AVRational{1, _arguments.SampleRate});
+                if (_dropSamples > frameStart) {
+                    swr_drop_output(swr_ctx, (int) (_dropSamples - frameStart));
+                }
             }
+            _dropSamples = -1;
+        }
 
-            // 记录当前时间
-            _pos = (frame->best_effort_timestamp / (double) stream->duration * _length);
-
-            // 进行重采样
-            auto resampled_frame = av_frame_alloc();
-            resampled_frame->sample_rate = _arguments.SampleRate;
-            resampled_frame->format = (int) _arguments.SampleFormat;
+        // 等到环形缓冲区放得下这一帧的输出；需要跳转或退出时放弃本包剩余的数据
+        int maxSamples = swr_get_out_samples(swr_ctx, frame->nb_samples);
+        if (!waitForSpace(std::min(maxSamples * blockAlign, _ring.capacity()))) {
+            av_frame_unref(frame);
+            break;
+        }
 
-            ret = av_channel_layout_copy(&resampled_frame->ch_layout, &out_ch_layout);
+        // 直接重采样到环形缓冲区中，回绕时分两次写出，余下的采样留在重采样器内
+        char *regions[2];
+        int sizes[2];
+        _ring.writeRegions(regions, sizes);
+
+        int written = 0;
+        auto in = (const uint8_t **) frame->extended_data;
+        int inSamples = frame->nb_samples;
+        for (int i = 0; i < 2 && sizes[i] > 0; ++i) {
+            auto out = (uint8_t *) regions[i];
+            int outSamples = sizes[i] / blockAlign;
+            ret = swr_convert(swr_ctx, &out, outSamples, in, inSamples);
             if (ret < 0) {
-                goto out_channel_copy;
+                break;
             }
-
-            ret = swr_convert_frame(swr_ctx, resampled_frame, frame);
-            if (ret == 0) {
-                auto &skip = remained;
-
-                int sz = av_samples_get_buffer_size(nullptr, resampled_frame->ch_layout.nb_channels,
-                                                    resampled_frame->nb_samples,
-                                                    _arguments.SampleFormat, 1);
-                auto arr = resampled_frame->data[0];
-
-                if (sz >= skip) {
-                    int size_need = size - bufferWriteOffset;
-                    int size_supply = sz - skip;
-
-                    // 写到输出缓冲区，写满了就存入cache
-                    if (size_supply > size_need) {
-                        // 写输出缓冲区
-                        ::memcpy(buf + bufferWriteOffset, arr + skip, size_need);
-
-                        // 存入cache
-                        _cachedBuffer.resize(size_supply - size_need);
-                        ::memcpy(_cachedBuffer.data(), arr + skip + size_need,
-                                 size_supply - size_need);
-                        _cachedBufferPos = 0;
-
-                        bufferWriteOffset = size;
-                    } else {
-                        // 全部写到输出缓冲区
-                        ::memcpy(buf + bufferWriteOffset, arr + skip, size_supply);
-                        bufferWriteOffset += size_supply;
-                    }
-                    skip = 0;
-                } else {
-                    skip -= sz;
-                }
-            } else {
-                // 忽略
-                if (ret == AVERROR_INVALIDDATA) {
-                    qDebug() << QString("FFmpeg: Error resampling frame with code %1, ignored")
-                                    .arg(QString::number(-ret));
-                } else {
-                    goto out_resample;
-                }
+            written += ret * blockAlign;
+            inSamples = 0; // 第二段只取出重采样器内缓存的输出
+            if (ret < outSamples) {
+                break;
             }
+        }
+        av_frame_unref(frame);
 
-            goto out_normal;
+        if (written > 0) {
+            _ring.commit(written);
 
-        out_channel_copy:
-            av_frame_free(&resampled_frame);
-            av_frame_unref(frame);
-            av_channel_layout_uninit(&out_ch_layout);
-            error_on_channel_copy(-ret);
-            return -1;
+            std::lock_guard lock(ringMutex);
+            ringCond.notify_all();
+        }
 
-        out_resample:
-            av_frame_free(&resampled_frame);
-            av_frame_unref(frame);
-            av_channel_layout_uninit(&out_ch_layout);
+        if (ret == AVERROR_INVALIDDATA) {
+            // 忽略
+            qDebug() << QString("FFmpeg: Error resampling frame with code %1, ignored")
+                            .arg(QString::number(-ret));
+        } else if (ret < 0) {
             qDebug() << QString("FFmpeg: Error resampling frame with code %1")
                             .arg(QString::number(-ret));
             return -1;
-
-        out_normal:
-            av_frame_free(&resampled_frame);
-            av_frame_unref(frame);
         }
     }
 
-    av_channel_layout_uninit(&out_ch_layout);
-    return bufferWriteOffset;
+    return 0;
+}
+
+bool FFmpegDecoderPrivate::waitForSpace(int size) {
+    std::unique_lock lock(ringMutex);
+    ringCond.wait(lock, [this, size]() { return _quit || _seekPending || _ring.writable() >= size; });
+    return !_quit && !_seekPending;
 }
 
-void FFmpegDecoderPrivate::seek() {
+void FFmpegDecoderPrivate::doSeek() {
     auto fmt_ctx = _formatContext;
     auto swr_ctx = _swrContext;
     auto codec_ctx = _codecContext;
 
-    _cachedBuffer.clear();
+    // 消费者正在等待跳转完成，此时可以安全地清空缓冲区
+    _ring.clear();
 
     // 必须清空内部缓存
     avcodec_flush_buffers(codec_ctx);
 
+    // 跳到目标之前最近的关键帧，再丢弃多余的采样
     auto stream = fmt_ctx->streams[_audioIndex];
-    qint64 timestamp = _pos / (double) _length * stream->duration;
+    qint64 targetSamples = _seekPos / (_arguments.Channels * _arguments.BytesPerSample());
+    qint64 timestamp = av_rescale_q(targetSamples, AVRational{1, _arguments.SampleRate}, stream->time_base);
 
-    int ret = av_seek_frame(fmt_ctx, _audioIndex, timestamp, AVSEEK_FLAG_FRAME);
+    int ret = av_seek_frame(fmt_ctx, _audioIndex, timestamp, AVSEEK_FLAG_BACKWARD);
     if (ret < 0) {
         qDebug() << QString("FFmpeg: Error seek frame with code %1").arg(QString::number(-ret));
     }
 
-    // 保存重采样器内部余量
-    _remainSamples = (int) swr_get_delay(swr_ctx, _waveFormat.SampleRate());
+    // 重置重采样器，丢掉跳转前的余量
+    swr_close(swr_ctx);
+    ret = swr_init(swr_ctx);
+    if (ret < 0) {
+        qDebug() << QString("FFmpeg: Error reset resampler with code %1").arg(QString::number(-ret));
+    }
+
+    _dropSamples = targetSamples;
 }
 
 int FFmpegDecoderPrivate::orgBytesPerSample() const {
@@ -8,9 +8,12 @@ extern "C" {
 }
 
 #include "../FFmpegDecoder.h"
+#include "PcmRing.h"
 
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
-#include <vector>
+#include <thread>
 
 class FFmpegDecoderPrivate {
     Q_DECLARE_PUBLIC(FFmpegDecoder);
@@ -26,8 +29,17 @@ public:
     bool initDecoder();
     void quitDecoder();
 
-    int decode(char *buf, int size);
-    void seek();
+    // 消费者：从环形缓冲区读取，buf 为空时跳过
+    int read(char *buf, int size);
+    void seek(qint64 pos);
+
+    // 生产者：预取线程
+    void startProducer();
+    void stopProducer();
+    void produce();
+    int decodePacket();
+    bool waitForSpace(int size);
+    void doSeek();
 
     FFmpegDecoder *q_ptr;
 
@@ -81,20 +93,33 @@ public:
     // 音频信息
     qint64 _length; // 单个声道总字节数
 
-    qint64 _pos; // 单个声道已处理的字节数
-
     int _audioIndex; // 音频流序号
 
     AVChannelLayout _channelLayout; // 输出声道布局
 
-    // 类内数据结构
-    std::vector<char> _cachedBuffer; // 内部缓冲区
+    // 预取数据
+    PcmRing _ring; // 已重采样的输出数据，由预取线程填充
+
+    std::atomic<qint64> _readPos; // 消费者已读出的输出字节数（所有声道）
+
+    qint64 _seekPos; // 待处理的跳转位置（输出字节数，所有声道）
+
+    qint64 _dropSamples; // 跳转后第一帧之前的采样需丢弃到此位置，-1 表示无需丢弃
+
+    // 预取线程状态，均受 ringMutex 保护
+    bool _seekPending;
+
+    bool _eof;
+
+    bool _quit;
+
+    std::thread *_producer;
 
-    int _cachedBufferPos; // 内部缓冲区读取位置
+    std::mutex ringMutex;
 
-    int _remainSamples; // 重采样器余量
+    std::condition_variable ringCond;
 
-    std::mutex lockObject;
+    std::mutex lockObject; // 串行化消费者一端的读取与跳转
 
     int orgBytesPerSample() const;
 
@@ -0,0 +1,75 @@
+#ifndef PCMRING_H
+#define PCMRING_H
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+// 单生产者单消费者的无锁环形缓冲区，读写两端各自只推进自己的位置
+class PcmRing {
+public:
+    void allocate(int capacity) {
+        _buffer.assign(capacity, 0);
+        clear();
+    }
+
+    // 仅在两端都不访问时调用
+    void clear() {
+        _readPos.store(0, std::memory_order_relaxed);
+        _writePos.store(0, std::memory_order_release);
+    }
+
+    int capacity() const {
+        return int(_buffer.size());
+    }
+
+    int readable() const {
+        return int(_writePos.load(std::memory_order_acquire) - _readPos.load(std::memory_order_acquire));
+    }
+
+    int writable() const {
+        return capacity() - readable();
+    }
+
+    // 生产者调用：取得可直接写入的空间，回绕时分为两段，第二段可能为空
+    void writeRegions(char *regions[2], int sizes[2]) {
+        const qint64 w = _writePos.load(std::memory_order_relaxed);
+        const qint64 r = _readPos.load(std::memory_order_acquire);
+        const int n = capacity() - int(w - r);
+        const int start = int(w % capacity());
+        regions[0] = _buffer.data() + start;
+        sizes[0] = std::min(n, capacity() - start);
+        regions[1] = _buffer.data();
+        sizes[1] = n - sizes[0];
+    }
+
+    // 生产者调用：提交已写入 writeRegions 空间的字节数
+    void commit(int size) {
+        _writePos.store(_writePos.load(std::memory_order_relaxed) + size, std::memory_order_release);
+    }
+
+    // 消费者调用，data 为空时直接丢弃，返回实际读出的字节数
+    int read(char *data, int size) {
+        const qint64 r = _readPos.load(std::memory_order_relaxed);
+        const qint64 w = _writePos.load(std::memory_order_acquire);
+        const int n = std::min(size, int(w - r));
+        if (data) {
+            const int start = int(r % capacity());
+            const int first = std::min(n, capacity() - start);
+            ::memcpy(data, _buffer.data() + start, first);
+            ::memcpy(data + first, _buffer.data(), n - first);
+        }
+        _readPos.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+private:
+    std::vector<char> _buffer;
+    std::atomic<qint64> _readPos{0};
+    std::atomic<qint64> _writePos{0};
+};
+
+#endif // PCMRING_H
@@ -0,0 +1,10 @@
+#include "QMFunctionRunnable.h"
+
+QMFunctionRunnable::QMFunctionRunnable(std::function<void()> func) : m_func(std::move(func)) {
+}
+
+QMFunctionRunnable::~QMFunctionRunnable() = default;
+
+void QMFunctionRunnable::run() {
+    m_func();
+}
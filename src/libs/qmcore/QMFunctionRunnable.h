@@ -0,0 +1,26 @@
+#ifndef QMFUNCTIONRUNNABLE_H
+#define QMFUNCTIONRUNNABLE_H
+
+#include <functional>
+
+#include <QRunnable>
+
+#include "QMGlobal.h"
+
+/**
+ * @brief Runs a function on a QThreadPool and deletes itself afterwards
+ *
+ * QThreadPool::start(std::function) is only available since Qt 5.15.
+ */
+class QMCORE_EXPORT QMFunctionRunnable : public QRunnable {
+public:
+    explicit QMFunctionRunnable(std::function<void()> func);
+    ~QMFunctionRunnable() override;
+
+    void run() override;
+
+private:
+    std::function<void()> m_func;
+};
+
+#endif // QMFUNCTIONRUNNABLE_H
@@ -0,0 +1,263 @@
+#include "QMSaveQueue.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <algorithm>
+
+static const quint32 JournalRecordMagic = 0x514D5344; // "QMSD"
+
+// Past this size the journal is rewritten with only the contents still queued
+static const qint64 JournalCompactSize = 4 << 20;
+
+// A record keeps prefix bytes from the front and suffix bytes from the back of the file's previous record and
+// replaces everything in between with middle.
+struct JournalDelta {
+    qint32 prefix = 0;
+    qint32 suffix = 0;
+    QByteArray middle;
+};
+
+static JournalDelta makeDelta(const QByteArray &base, const QByteArray &contents) {
+    const int limit = std::min(base.size(), contents.size());
+    JournalDelta delta;
+    while (delta.prefix < limit && base[delta.prefix] == contents[delta.prefix])
+        delta.prefix++;
+    while (delta.suffix < limit - delta.prefix &&
+           base[base.size() - 1 - delta.suffix] == contents[contents.size() - 1 - delta.suffix])
+        delta.suffix++;
+    delta.middle = contents.mid(delta.prefix, contents.size() - delta.prefix - delta.suffix);
+    return delta;
+}
+
+static bool applyDelta(const QByteArray &base, const JournalDelta &delta, QByteArray &contents) {
+    if (delta.prefix < 0 || delta.suffix < 0 || delta.prefix + delta.suffix > base.size())
+        return false;
+    contents = base.left(delta.prefix) + delta.middle + base.right(delta.suffix);
+    return true;
+}
+
+static QString journalPath(const QString &dirname) {
+    const QByteArray key = QDir(dirname).absolutePath().toUtf8();
+    return QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/journals/" +
+           QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex() + ".journal";
+}
+
+static bool writeAtomically(const QString &filename, const QByteArray &contents, bool text, QString &errorString) {
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | (text ? QIODevice::Text : QIODevice::NotOpen)) ||
+        file.write(contents) != contents.size() || !file.commit()) {
+        errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QMSaveQueue::QMSaveQueue(QObject *parent) : QObject(parent) {
+    m_thread = QThread::create([this]() { run(); });
+    m_thread->start();
+}
+
+QMSaveQueue::~QMSaveQueue() {
+    {
+        QMutexLocker locker(&m_mutex);
+        retryFailed();
+        m_quit = true;
+        m_wake.wakeAll();
+    }
+    m_thread->wait();
+    delete m_thread;
+    closeJournal();
+}
+
+void QMSaveQueue::setDirectory(const QString &dirname) {
+    flush();
+
+    QMutexLocker locker(&m_mutex);
+    closeJournal();
+    openJournal(dirname);
+}
+
+void QMSaveQueue::save(const QString &filename, const QByteArray &contents, bool text) {
+    QMutexLocker locker(&m_mutex);
+    appendJournal(filename, contents, text);
+
+    // A new save is a good moment to retry files that failed before
+    retryFailed();
+    m_pending.insert(filename, {contents, text, ++m_serial, false});
+    m_wake.wakeAll();
+}
+
+bool QMSaveQueue::pending(const QString &filename, QByteArray *contents) const {
+    QMutexLocker locker(&m_mutex);
+    auto it = m_pending.constFind(filename);
+    if (it == m_pending.constEnd())
+        return false;
+    if (contents)
+        *contents = it->contents;
+    return true;
+}
+
+bool QMSaveQueue::flush() {
+    QMutexLocker locker(&m_mutex);
+    retryFailed();
+    m_wake.wakeAll();
+    while (m_busy || hasWork())
+        m_idle.wait(&m_mutex);
+    return m_pending.isEmpty();
+}
+
+void QMSaveQueue::run() {
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        while (!m_quit && !hasWork())
+            m_wake.wait(&m_mutex);
+        if (!hasWork())
+            break;
+
+        // Write a snapshot without holding the lock; saves arriving meanwhile replace entries with a newer serial
+        const auto batch = m_pending;
+        m_busy = true;
+        locker.unlock();
+
+        QHash<QString, quint64> written;
+        QHash<QString, QPair<quint64, QString>> failed;
+        for (auto it = batch.constBegin(); it != batch.constEnd(); ++it) {
+            if (it->failed)
+                continue;
+            QString errorString;
+            if (writeAtomically(it.key(), it->contents, it->text, errorString))
+                written.insert(it.key(), it->serial);
+            else
+                failed.insert(it.key(), {it->serial, errorString});
+        }
+
+        locker.relock();
+        m_busy = false;
+        for (auto it = written.constBegin(); it != written.constEnd(); ++it) {
+            auto entry = m_pending.find(it.key());
+            if (entry != m_pending.end() && entry->serial == it.value())
+                m_pending.erase(entry);
+        }
+        for (auto it = failed.constBegin(); it != failed.constEnd(); ++it) {
+            auto entry = m_pending.find(it.key());
+            if (entry != m_pending.end() && entry->serial == it.value().first)
+                entry->failed = true;
+        }
+        // Everything is on disk, so the journal has nothing left to recover
+        if (m_pending.isEmpty())
+            resetJournal();
+        m_idle.wakeAll();
+
+        locker.unlock();
+        for (auto it = written.constBegin(); it != written.constEnd(); ++it)
+            emit saved(it.key());
+        for (auto it = failed.constBegin(); it != failed.constEnd(); ++it)
+            emit saveFailed(it.key(), it.value().second);
+        locker.relock();
+    }
+}
+
+bool QMSaveQueue::hasWork() const {
+    for (const auto &entry : m_pending)
+        if (!entry.failed)
+            return true;
+    return false;
+}
+
+void QMSaveQueue::retryFailed() {
+    for (auto &entry : m_pending)
+        entry.failed = false;
+}
+
+void QMSaveQueue::openJournal(const QString &dirname) {
+    m_journal.setFileName(journalPath(dirname));
+    QDir().mkpath(QFileInfo(m_journal).absolutePath());
+    if (!m_journal.open(QIODevice::ReadWrite))
+        return; // No writable app data, saves are still queued but not journaled
+
+    // Replay what a previous session queued but never wrote; the last record of a file wins. A record cut short by
+    // the crash, or one that does not fit the record before it, ends the replay and is cut off, so new records are
+    // not appended behind it.
+    QDataStream stream(&m_journal);
+    stream.setVersion(QDataStream::Qt_5_0);
+    qint64 validSize = 0;
+    while (!stream.atEnd()) {
+        quint32 magic;
+        QString filename;
+        bool text;
+        JournalDelta delta;
+        stream >> magic >> filename >> text >> delta.prefix >> delta.suffix >> delta.middle;
+        QByteArray contents;
+        if (stream.status() != QDataStream::Ok || magic != JournalRecordMagic ||
+            !applyDelta(m_journaled.value(filename), delta, contents))
+            break;
+        m_journaled.insert(filename, contents);
+        m_pending.insert(filename, {contents, text, ++m_serial, false});
+        validSize = m_journal.pos();
+    }
+    // New records go after the replayed ones, the journal is emptied once they are all written
+    m_journal.resize(validSize);
+    m_journal.seek(validSize);
+    m_wake.wakeAll();
+}
+
+void QMSaveQueue::closeJournal() {
+    m_journaled.clear();
+    if (!m_journal.isOpen())
+        return;
+    const bool empty = m_journal.size() == 0;
+    m_journal.close();
+    if (empty)
+        m_journal.remove();
+}
+
+void QMSaveQueue::appendJournal(const QString &filename, const QByteArray &contents, bool text) {
+    if (!m_journal.isOpen())
+        return;
+    if (m_journal.size() > JournalCompactSize)
+        compactJournal();
+
+    const JournalDelta delta = makeDelta(m_journaled.value(filename), contents);
+    QDataStream stream(&m_journal);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << JournalRecordMagic << filename << text << delta.prefix << delta.suffix << delta.middle;
+    m_journal.flush();
+    m_journaled.insert(filename, contents);
+}
+
+void QMSaveQueue::compactJournal() {
+    // One full record per queued file; this also bounds the journal while writes keep failing
+    QSaveFile compacted(m_journal.fileName());
+    if (!compacted.open(QIODevice::WriteOnly))
+        return;
+    QHash<QString, QByteArray> journaled;
+    QDataStream stream(&compacted);
+    stream.setVersion(QDataStream::Qt_5_0);
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        stream << JournalRecordMagic << it.key() << it->text << qint32(0) << qint32(0) << it->contents;
+        journaled.insert(it.key(), it->contents);
+    }
+    m_journal.close();
+    if (!compacted.commit()) {
+        m_journal.open(QIODevice::ReadWrite | QIODevice::Append);
+        return;
+    }
+    m_journal.open(QIODevice::ReadWrite | QIODevice::Append);
+    m_journaled = journaled;
+}
+
+void QMSaveQueue::resetJournal() {
+    m_journaled.clear();
+    if (!m_journal.isOpen())
+        return;
+    m_journal.resize(0);
+    m_journal.seek(0);
+}
@@ -0,0 +1,100 @@
+#ifndef QMSAVEQUEUE_H
+#define QMSAVEQUEUE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QWaitCondition>
+
+#include "QMGlobal.h"
+
+class QThread;
+
+/**
+ * @brief Writes files on a background thread so the UI never waits for the disk
+ *
+ * Every save is first appended to a journal of the working directory, then a worker thread writes the latest
+ * contents of each file with an atomic rename. Saves of the same file that pile up are written once. The journal
+ * lives in the user's local app data rather than next to the files, so appending to it never waits on a slow share,
+ * and it only records what changed since the previous save of a file. It is emptied whenever everything queued is on
+ * disk, rewritten with just the queued contents when it grows too large, and a journal left behind by a crash is
+ * written out the next time the directory is opened.
+ */
+class QMCORE_EXPORT QMSaveQueue : public QObject {
+    Q_OBJECT
+public:
+    explicit QMSaveQueue(QObject *parent = nullptr);
+    ~QMSaveQueue() override;
+
+    /**
+     * @brief Journal saves in dirname from now on, after replaying a journal left there
+     *
+     */
+    void setDirectory(const QString &dirname);
+
+    /**
+     * @brief Queue contents to be written to filename, in text mode if text is true
+     *
+     */
+    void save(const QString &filename, const QByteArray &contents, bool text = false);
+
+    /**
+     * @brief Get the queued contents of filename that are not on disk yet
+     *
+     * @return false if nothing is queued for filename
+     */
+    bool pending(const QString &filename, QByteArray *contents = nullptr) const;
+
+    /**
+     * @brief Block until every queued file is written, retrying failed ones once
+     *
+     * @return false if a file still cannot be written
+     */
+    bool flush();
+
+signals:
+    /**
+     * @brief filename was written to disk
+     *
+     */
+    void saved(const QString &filename);
+
+    /**
+     * @brief A file could not be written; its contents stay queued and in the journal
+     *
+     */
+    void saveFailed(const QString &filename, const QString &errorString);
+
+private:
+    struct Entry {
+        QByteArray contents;
+        bool text = false;
+        quint64 serial = 0;
+        bool failed = false;
+    };
+
+    void run();
+    bool hasWork() const;
+    void retryFailed();
+    void openJournal(const QString &dirname);
+    void closeJournal();
+    void appendJournal(const QString &filename, const QByteArray &contents, bool text);
+    void compactJournal();
+    void resetJournal();
+
+    QThread *m_thread;
+    mutable QMutex m_mutex;
+    QWaitCondition m_wake;
+    QWaitCondition m_idle;
+    QHash<QString, Entry> m_pending;
+    QFile m_journal;
+    QHash<QString, QByteArray> m_journaled; // Last journaled contents of each file, the base of its next record
+    quint64 m_serial = 0;
+    bool m_busy = false;
+    bool m_quit = false;
+};
+
+#endif // QMSAVEQUEUE_H
@@ -13,6 +13,11 @@
 #    include <unistd.h>
 #endif
 
+#ifdef Q_OS_LINUX
+#    include <linux/fs.h>
+#    include <sys/ioctl.h>
+#endif
+
 static const char Slash = '/';
 
 #define Q_D_EXPLORE(str)                                                                                               \
@@ -50,6 +55,35 @@ namespace QMFs {
     }
 
 
+    bool copyFast(const QString &fileName, const QString &newName) {
+#ifdef Q_OS_LINUX
+        QFile source(fileName);
+        QFile target(newName);
+        if (source.open(QIODevice::ReadOnly) && target.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+#    ifdef FICLONE
+            // Copy-on-write clone, no data is copied at all on Btrfs, XFS and the like
+            if (::ioctl(target.handle(), FICLONE, source.handle()) == 0) {
+                return true;
+            }
+#    endif
+            // Otherwise the kernel copies without passing the data through user space
+            qint64 remaining = source.size();
+            while (remaining > 0) {
+                ssize_t n = ::copy_file_range(source.handle(), nullptr, target.handle(), nullptr, remaining, 0);
+                if (n <= 0) {
+                    break;
+                }
+                remaining -= n;
+            }
+            if (remaining == 0) {
+                return true;
+            }
+        }
+        target.close();
+#endif
+        return copy(fileName, newName);
+    }
+
     bool combine(const QString &fileName1, const QString &fileName2, const QString &newName) {
         QFile file1(fileName1);
         QFile file2(fileName2);
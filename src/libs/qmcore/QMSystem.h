@@ -65,6 +65,9 @@ namespace QMFs {
         return (!file.exists() || file.remove()) && QFile::copy(fileName, newName);
     }
 
+    // Like copy, but lets the file system clone the data (reflink or in-kernel copy) where it can
+    QMCORE_EXPORT bool copyFast(const QString &fileName, const QString &newName);
+
     QMCORE_EXPORT bool combine(const QString &fileName1, const QString &fileName2, const QString &newName);
 
     QMCORE_EXPORT void reveal(const QString &filename);